@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# time egel programs with one or more interpreters, e.g., to compare a
+# build against a baseline:
+#
+#   bench.sh -n 5 ./egel /tmp/egel.old -- tests/million.eg tests/huge.eg
+
+usage="egel [egel..] -- fn [fn..]" least=3 . "$(dirname "$0")/bench_args.sh"
+
+bins=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+  bins+=("$1"); shift
+done
+shift
+
+incdir=$(dirname "$0")/../../include
+
+for fn in "$@"; do
+  for bin in "${bins[@]}"; do
+    best=0
+    for ((r = 0; r < runs; r++)); do
+      start=$(date +%s%N)
+      "$bin" -I "$incdir" "$fn" > /dev/null 2>&1 || echo "$bin $fn: failed"
+      stop=$(date +%s%N)
+      t=$(((stop - start) / 1000000))
+      if [ $best -eq 0 ] || [ $t -lt $best ]; then
+        best=$t
+      fi
+    done
+    printf "%-24s %-24s %8d ms\n" "$(basename $fn)" "$bin" $best
+  done
+done
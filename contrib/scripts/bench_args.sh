@@ -0,0 +1,16 @@
+# the arguments every bench script takes, sourced with the usage and the
+# least and most number of arguments after the options, e.g.,
+#
+#   usage="egel [egel..]" least=1 . "$(dirname "$0")/bench_args.sh"
+#
+# leaves the number of runs in runs and shifts the options off
+
+runs=3
+if [ "$1" == "-n" ]; then
+  runs=$2; shift; shift
+fi
+
+if [ $# -lt "${least:-0}" ] || [ $# -gt "${most:-$#}" ]; then
+  echo "usage: $0 [-n runs] $usage"
+  exit 1
+fi
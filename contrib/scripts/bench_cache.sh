@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# compare startup with the module cache against recompiling every module,
+# the first run fills the cache so the best time is a warm start, run from
+# the top directory:
+#
+#   contrib/scripts/bench_cache.sh [-n runs] egel [fn..]
+
+usage="egel [fn..]" least=1 . "$(dirname "$0")/bench_args.sh"
+
+bin=$(realpath "$1"); shift
+
+fns=("$@")
+if [ ${#fns[@]} -eq 0 ]; then
+  fns=(examples/fizzbuzz.eg examples/parser.eg examples/nqueens.eg)
+fi
+
+# bench.sh takes interpreters, not flags
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cat > "$dir/egel-cache" <<EOF
+#!/bin/sh
+exec "$bin" --cache="$dir/cache" "\$@"
+EOF
+cat > "$dir/egel-no-cache" <<EOF
+#!/bin/sh
+exec "$bin" --no-cache "\$@"
+EOF
+chmod +x "$dir/egel-cache" "$dir/egel-no-cache"
+
+$(dirname "$0")/bench.sh -n "$runs" "$dir"/egel-cache "$dir"/egel-no-cache \
+  -- "${fns[@]}"
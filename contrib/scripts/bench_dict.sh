@@ -0,0 +1,14 @@
+#!/bin/bash
+
+# compare the ordered dictionary against the hashed one on a million
+# integer and text keys, run from the top directory:
+#
+#   contrib/scripts/bench_dict.sh [-n runs] egel
+
+usage="egel" least=1 most=1 . "$(dirname "$0")/bench_args.sh"
+
+hashed=$(mktemp --suffix=.eg)
+trap 'rm -f "$hashed"' EXIT
+sed -e 's/Dict::dict /Dict::dict_hashed /g' tests/dict.eg > "$hashed"
+
+$(dirname "$0")/bench.sh -n "$runs" "$1" -- tests/dict.eg "$hashed"
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# compare the bytecode interpreter (--no-jit) against native code on the
+# examples, run from the top directory:
+#
+#   contrib/scripts/bench_interp.sh [-n runs] [fn..]
+
+usage="[fn..]" . "$(dirname "$0")/bench_args.sh"
+
+fns=("$@")
+if [ ${#fns[@]} -eq 0 ]; then
+  fns=(examples/nqueens.eg examples/bintrees.eg examples/ackermann.eg)
+fi
+
+jobs=$(nproc 2>/dev/null || echo 2)
+
+cmake -S . -B build-interp -DCMAKE_BUILD_TYPE=Release > /dev/null || exit 1
+cmake --build build-interp -j"$jobs" --target egel > /dev/null || exit 1
+
+# bench.sh takes interpreters, not flags
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cat > "$dir/egel-no-jit" <<END
+#!/bin/sh
+exec "$PWD/build-interp/egel" --no-jit "\$@"
+END
+chmod +x "$dir/egel-no-jit"
+
+$(dirname "$0")/bench.sh -n "$runs" build-interp/egel "$dir/egel-no-jit" \
+  -- "${fns[@]}"
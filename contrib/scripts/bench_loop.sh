@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# time self tail recursive loops, e.g., to compare looping self calls
+# against a baseline build, run from the top directory:
+#
+#   contrib/scripts/bench_loop.sh [-n runs] egel [egel..]
+
+usage="egel [egel..]" least=1 . "$(dirname "$0")/bench_args.sh"
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/count.eg" <<'EOF2'
+import "prelude.eg"
+
+using System
+
+def count = [ 0 A -> A | N A -> count (N - 1) (A + 1) ]
+
+def main = count 5000000 0
+EOF2
+
+cat > "$dir/fold.eg" <<'EOF2'
+import "prelude.eg"
+
+using System
+
+def main = List::foldl [ N _ -> N + 1 ] 0 (List::repeat 1000000 none)
+EOF2
+
+$(dirname "$0")/bench.sh -n "$runs" "$@" -- "$dir"/*.eg
@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# count the bytecode instructions per combinator, and time the programs, to
+# compare match compilation against a baseline build, run from the top
+# directory:
+#
+#   contrib/scripts/bench_match.sh [-n runs] egel egel.old [fn..]
+
+usage="egel egel.old [fn..]" least=2 . "$(dirname "$0")/bench_args.sh"
+
+new=$1; old=$2; shift; shift
+
+fns=("$@")
+if [ ${#fns[@]} -eq 0 ]; then
+  fns=(examples/assembler.eg examples/lambda2sk.eg examples/lambool.eg)
+fi
+
+incdir=$(dirname "$0")/../../include
+
+# combinator name and instruction count from a bytecode dump
+count() {
+  "$1" -I "$incdir" -B "$2" 2>/dev/null | awk '
+    /^code$/ { n = 0; inside = 1; next }
+    /^data$/ { if (inside) print name, n; inside = 0; next }
+    inside && /^  0x/ { if ($2 != "fail") n++; next }
+    { name = $1 }'
+}
+
+for fn in "${fns[@]}"; do
+  echo "$fn"
+  join -a 1 -e - -o 0,1.2,2.2 \
+    <(count "$old" "$fn" | sort) <(count "$new" "$fn" | sort) |
+    awk '$2 != $3 { printf "  %-32s %6s %6s\n", $1, $2, $3 }'
+done
+
+$(dirname "$0")/bench.sh -n "$runs" "$old" "$new" -- "${fns[@]}"
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# time arithmetic heavy examples, bounded so they terminate, e.g., to compare
+# inlined primitives against a baseline build, run from the top directory:
+#
+#   contrib/scripts/bench_prim.sh [-n runs] egel [egel..]
+
+usage="egel [egel..]" least=1 . "$(dirname "$0")/bench_args.sh"
+
+ex=$(dirname "$0")/../../examples
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+sed 's/fib 40/fib 27/' "$ex/fib.eg" > "$dir/fib.eg"
+
+sed '/^def main/,$d' "$ex/sieve.eg" > "$dir/sieve.eg"
+cat >> "$dir/sieve.eg" <<'EOF'
+def sum =
+    [ 0 S -> 0 | N S -> let (X, S) = S none in X + sum (N - 1) S ]
+
+def main = sum 1000 (sieve nums)
+EOF
+
+sed 's/^def main =/def mandelbrot =/' "$ex/mandelbrot.eg" > "$dir/mandelbrot.eg"
+cat >> "$dir/mandelbrot.eg" <<'EOF'
+
+def main = List::foldl [ _ N -> mandelbrot ] none (List::from_to 1 100)
+EOF
+
+$(dirname "$0")/bench.sh -n "$runs" "$@" -- "$dir"/*.eg
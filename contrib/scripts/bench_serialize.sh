@@ -0,0 +1,14 @@
+#!/bin/bash
+
+# compare the text serialization against the binary one on large lists
+# and lists of combinators, run from the top directory:
+#
+#   contrib/scripts/bench_serialize.sh [-n runs] egel
+
+usage="egel" least=1 most=1 . "$(dirname "$0")/bench_args.sh"
+
+text=$(mktemp --suffix=.eg)
+trap 'rm -f "$text"' EXIT
+sed -e 's/serialize_binary /serialize /g' tests/serialize.eg > "$text"
+
+$(dirname "$0")/bench.sh -n "$runs" "$1" -- "$text" tests/serialize.eg
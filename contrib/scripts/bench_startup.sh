@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# time loading programs with thousands of namespaces, generated with
+# tests/large.py, e.g., to compare startup against a baseline build, run
+# from the top directory:
+#
+#   contrib/scripts/bench_startup.sh [-n runs] egel [egel..]
+
+usage="egel [egel..]" least=1 . "$(dirname "$0")/bench_args.sh"
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+for n in 1000 2000 5000; do
+  python3 $(dirname "$0")/../../tests/large.py $n > "$dir/large_$n.eg"
+done
+
+$(dirname "$0")/bench.sh -n "$runs" "$@" -- "$dir"/large_*.eg
@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# time building and then dropping lists of a million and ten million cons
+# cells, e.g., to compare teardown against a baseline build, run from the
+# top directory:
+#
+#   contrib/scripts/bench_teardown.sh [-n runs] egel [egel..]
+
+usage="egel [egel..]" least=1 . "$(dirname "$0")/bench_args.sh"
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+for n in 1000000 10000000; do
+  cat > "$dir/teardown_$n.eg" <<END
+import "prelude.eg"
+
+using System
+
+# the list is alive until the length is known, then dropped at once
+def main = let XX = List::from_to 1 $n in List::length XX
+END
+done
+
+$(dirname "$0")/bench.sh -n "$runs" "$@" -- "$dir"/teardown_*.eg
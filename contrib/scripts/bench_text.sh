@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# time concatenating, splitting and searching about a hundred megabytes of
+# text, e.g., to compare text slicing against a baseline build, run from
+# the top directory:
+#
+#   contrib/scripts/bench_text.sh [-n runs] egel [egel..]
+
+usage="egel [egel..]" least=1 . "$(dirname "$0")/bench_args.sh"
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# two million lines by doubling a line 21 times
+cat > "$dir/text.eg" <<'END'
+import "prelude.eg"
+
+using System
+
+def double = [ 0 S -> S | N S -> double (N - 1) (String::append S S) ]
+
+def input = double 21 "  the quick brown fox jumps over the lazy dog  \n"
+END
+
+cat "$dir/text.eg" - > "$dir/text_concat.eg" <<'END'
+
+def main = String::length input
+END
+
+cat "$dir/text.eg" - > "$dir/text_split.eg" <<'END'
+
+def main = List::length (Regex::split (Regex::compile "\n") input)
+END
+
+cat "$dir/text.eg" - > "$dir/text_search.eg" <<'END'
+
+def found = [ L -> String::index_of "lazy" (String::extract 4 35 L) > 0 ]
+
+def main =
+    let LL = Regex::split (Regex::compile "\n") input in
+    List::foldl [ N L -> if found (String::trim L) then N + 1 else N ] 0 LL
+END
+
+$(dirname "$0")/bench.sh -n "$runs" "$@" -- "$dir"/text_*.eg
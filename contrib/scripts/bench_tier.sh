@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# compare the native code modes, eager, lazy, and off, on startup with the
+# prelude and on the examples, run from the top directory:
+#
+#   contrib/scripts/bench_tier.sh [-n runs] [fn..]
+
+usage="[fn..]" . "$(dirname "$0")/bench_args.sh"
+
+fns=("$@")
+if [ ${#fns[@]} -eq 0 ]; then
+  fns=(examples/nqueens.eg examples/bintrees.eg examples/ackermann.eg)
+fi
+
+jobs=$(nproc 2>/dev/null || echo 2)
+
+cmake -S . -B build-tier -DCMAKE_BUILD_TYPE=Release > /dev/null || exit 1
+cmake --build build-tier -j"$jobs" --target egel > /dev/null || exit 1
+
+# bench.sh takes interpreters, not flags
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+for mode in eager lazy off; do
+  cat > "$dir/egel-$mode" <<EOF
+#!/bin/sh
+exec "$PWD/build-tier/egel" --jit=$mode "\$@"
+EOF
+  chmod +x "$dir/egel-$mode"
+done
+
+cat > "$dir/startup.eg" <<'EOF'
+import "prelude.eg"
+
+def main = 0
+EOF
+
+$(dirname "$0")/bench.sh -n "$runs" "$dir"/egel-eager "$dir"/egel-lazy \
+  "$dir"/egel-off -- "$dir/startup.eg" "${fns[@]}"
@@ -20,10 +20,15 @@ struct Greater {
     }
 };
 
-typedef std::priority_queue<std::pair<VMObjectPtr, VMObjectPtr>,
-                            std::vector<std::pair<VMObjectPtr, VMObjectPtr>>,
-                            Greater>
-    pqueue_t;
+// exposes the underlying container to report the elements when shared
+struct pqueue_t
+    : public std::priority_queue<
+          std::pair<VMObjectPtr, VMObjectPtr>,
+          std::vector<std::pair<VMObjectPtr, VMObjectPtr>>, Greater> {
+    const container_type& container() const {
+        return c;
+    }
+};
 
 class PQueue : public Opaque {
 public:
@@ -72,9 +77,20 @@ DOCSTRING("System::pqueue - a pqueue");
     }
 
     void push(const VMObjectPtr& k, const VMObjectPtr& v) {
+        if (is_shared()) {
+            share_object(k);
+            share_object(v);
+        }
         _value.push(std::pair<VMObjectPtr, VMObjectPtr>(k, v));
     }
 
+    void shared_children(std::vector<const VMObject*>& oo) const override {
+        for (auto& [k, v] : _value.container()) {
+            oo.push_back(k.get());
+            oo.push_back(v.get());
+        }
+    }
+
 protected:
     pqueue_t _value;
 };
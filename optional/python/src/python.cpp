@@ -217,7 +217,7 @@ public:
     int compare(const VMObjectPtr& o) override {
         return false;
         /* XXX: for later
-        auto v = (std::static_pointer_cast<PythonMachine>(o))->value();
+        auto v = (vm_ptr_cast<PythonMachine>(o))->value();
         if (_value < v) return -1;
         else if (v < _value) return 1;
         else return 0;
@@ -241,14 +241,14 @@ protected:
 #define PYTHON_MACHINE_TEST(o)                \
     ((o->subtag() == VM_SUB_PYTHON_OBJECT) && \
      (o->to_text() == "Python:::machine"))
-#define PYTHON_MACHINE_CAST(o) std::static_pointer_cast<PythonMachine>(o)
+#define PYTHON_MACHINE_CAST(o) vm_ptr_cast<PythonMachine>(o)
 
 /**
  * A Python object.
  **/
 
 class PythonObject;
-typedef std::shared_ptr<PythonObject> PythonObjectPtr;
+typedef vm_ptr<PythonObject> PythonObjectPtr;
 
 class PythonObject : public Opaque {
 public:
@@ -264,11 +264,11 @@ public:
     }
 
     VMObjectPtr create() const {
-        return std::make_shared<PythonObject>(*this);
+        return make_vm_ptr<PythonObject>(*this);
     }
 
     static VMObjectPtr create(VM* vm, PyObject* o) {
-        return std::make_shared<PythonObject>(vm, o);
+        return make_vm_ptr<PythonObject>(vm, o);
     }
 
     static VMObjectPtr create(VM* vm, const PyObject* o) {
@@ -276,7 +276,7 @@ public:
     }
 
     int compare(const VMObjectPtr& o) override {
-        auto v = (std::static_pointer_cast<PythonObject>(o))->value();
+        auto v = (vm_ptr_cast<PythonObject>(o))->value();
         // XXX: use python compare
         return false;
     }
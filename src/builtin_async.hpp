@@ -2,8 +2,19 @@
 
 #include <stdlib.h>
 
+#include <atomic>
 #include <chrono>
-#include <future>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "runtime.hpp"
 
@@ -15,6 +26,284 @@ namespace egel {
 
 // DOCSTRING("namespace System - async tasks support");
 
+// a task reduces one application, it is claimed exactly once, either by a
+// worker or by a thread which awaits it before a worker got to it
+class Task {
+public:
+    enum state_t { PENDING, RUNNING, DONE };
+
+    Task(VM *vm, const VMObjectPtr &o) : _machine(vm), _app(o) {
+    }
+
+    bool claim() {
+        int s = PENDING;
+        return _state.compare_exchange_strong(s, RUNNING);
+    }
+
+    bool done() const {
+        return _state.load() == DONE;
+    }
+
+    void run() {
+        VMReduceResult r;
+        std::exception_ptr x;
+        try {
+            r = _machine->reduce(_app);
+            share_object(r.result);  // handed back to the awaiting thread
+        } catch (...) {
+            x = std::current_exception();
+        }
+        _app = nullptr;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _result = r;
+        _error = x;
+        _state = DONE;
+        _cv.notify_all();
+    }
+
+    bool wait_for(std::chrono::milliseconds ms) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _cv.wait_for(lock, ms, [this] { return done(); });
+    }
+
+    VMReduceResult result() const {
+        if (_error) std::rethrow_exception(_error);
+        return _result;
+    }
+
+private:
+    VM *_machine;
+    VMObjectPtr _app;
+    std::atomic<int> _state = PENDING;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    VMReduceResult _result;
+    std::exception_ptr _error;
+};
+
+using TaskPtr = std::shared_ptr<Task>;
+
+// a pool of workers, started on the first task. a worker pushes and pops
+// the tasks it spawns at the back of its own deque, idle workers steal from
+// the front of the deques of others, and tasks spawned by other threads go
+// to a shared queue. a worker which blocks, in await, sleep, or on a
+// mailbox, is compensated for with a spare thread when no worker is idle,
+// spares leave once there are enough unblocked workers again. workers are
+// never joined, like the main thread they may be stuck in a reduction when
+// the program exits.
+class TaskPool {
+public:
+#ifdef __APPLE__
+    static constexpr size_t STACK_SIZE = 8 * 1024 * 1024;
+#else
+    static constexpr size_t STACK_SIZE = 128 * 1024 * 1024;
+#endif
+    static constexpr auto SPARE_LINGER = std::chrono::milliseconds(100);
+
+    // set the number of workers, zero for one per core, before the first
+    // task is spawned
+    static void set_workers(int n) {
+        _workers = n;
+    }
+
+    static TaskPool &pool() {
+        static TaskPool *p = new TaskPool();  // leaked, see above
+        return *p;
+    }
+
+    // a region in which the calling thread may block, a no-op outside the
+    // pool
+    class Blocking {
+    public:
+        Blocking() : _pooled(TaskPool::_pooled) {
+            if (_pooled) pool().block();
+        }
+
+        ~Blocking() {
+            if (_pooled) pool().unblock();
+        }
+
+    private:
+        bool _pooled;
+    };
+
+    void submit(const TaskPtr &t) {
+        if (_worker >= 0) {
+            auto &w = *_queues[_worker];
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.tasks.push_back(t);
+        } else {
+            std::lock_guard<std::mutex> lock(_shared.mutex);
+            _shared.tasks.push_back(t);
+        }
+        _pending++;
+        if (_idle.load() > 0) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cv.notify_one();
+        }
+    }
+
+    // run the task when nobody did yet, otherwise block until it is done,
+    // other tasks are never run on the stack of an awaiting thread
+    void await(const TaskPtr &t) {
+        if (t->claim()) {
+            t->run();
+            return;
+        }
+        Blocking b;
+        while (!t->done()) {
+            t->wait_for(std::chrono::milliseconds(100));
+        }
+    }
+
+private:
+    struct queue_t {
+        std::mutex mutex;
+        std::deque<TaskPtr> tasks;
+    };
+
+    TaskPool() {
+        int n = _workers;
+        if (n <= 0) n = std::thread::hardware_concurrency();
+        if (n <= 0) n = 1;
+        _target = n;
+        _active = n;
+        for (int i = 0; i < n; i++) {
+            _queues.push_back(std::make_unique<queue_t>());
+        }
+        for (int i = 0; i < n; i++) {
+            start(i);
+        }
+    }
+
+    // a worker blocks, start a spare when no worker is idle to take over
+    void block() {
+        auto a = --_active;
+        if ((a < _target) && (_idle.load() == 0)) {
+            _active++;
+            start(-1);
+        }
+    }
+
+    void unblock() {
+        if (++_active > _target) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cv.notify_all();
+        }
+    }
+
+    // a spare leaves when there are more unblocked workers than wanted
+    bool leave() {
+        auto a = _active.load();
+        while (a > _target) {
+            if (_active.compare_exchange_weak(a, a - 1)) return true;
+        }
+        return false;
+    }
+
+#ifdef _WIN32
+    void start(int i) {
+        std::thread(&TaskPool::work, this, i).detach();
+    }
+#else
+    static void *entry(void *a) {
+        auto w = static_cast<std::pair<TaskPool *, int> *>(a);
+        auto [p, i] = *w;
+        delete w;
+        p->work(i);
+        return nullptr;
+    }
+
+    void start(int i) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, STACK_SIZE);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_t tid;
+        auto a = new std::pair<TaskPool *, int>(this, i);
+        if (pthread_create(&tid, &attr, entry, a) != 0) {
+            delete a;
+            std::thread(&TaskPool::work, this, i).detach();
+        }
+        pthread_attr_destroy(&attr);
+    }
+#endif
+
+    static TaskPtr pop_back(queue_t &q) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return nullptr;
+        auto t = q.tasks.back();
+        q.tasks.pop_back();
+        return t;
+    }
+
+    static TaskPtr pop_front(queue_t &q) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return nullptr;
+        auto t = q.tasks.front();
+        q.tasks.pop_front();
+        return t;
+    }
+
+    // own work first, then the shared queue, then steal
+    TaskPtr take() {
+        if (_pending.load() == 0) return nullptr;
+        TaskPtr t;
+        if (_worker >= 0) t = pop_back(*_queues[_worker]);
+        if (t == nullptr) t = pop_front(_shared);
+        size_t n = _queues.size();
+        size_t s = (_worker >= 0) ? _worker + 1 : 0;
+        for (size_t i = 0; (t == nullptr) && (i < n); i++) {
+            auto v = (s + i) % n;
+            if ((int)v != _worker) t = pop_front(*_queues[v]);
+        }
+        if (t != nullptr) _pending--;
+        return t;
+    }
+
+    // tasks claimed by an awaiting thread are still queued, skip those
+    static void run(const TaskPtr &t) {
+        if (t->claim()) t->run();
+    }
+
+    // workers own a deque, spares (i < 0) only take
+    void work(int i) {
+        _worker = i;
+        _pooled = true;
+        while (true) {
+            auto t = take();
+            if (t != nullptr) {
+                run(t);
+            } else if ((i < 0) && leave()) {
+                return;
+            } else {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _idle++;
+                if (i < 0) {
+                    _cv.wait_for(lock, SPARE_LINGER,
+                                 [this] { return _pending.load() > 0; });
+                } else {
+                    _cv.wait(lock, [this] { return _pending.load() > 0; });
+                }
+                _idle--;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<queue_t>> _queues;
+    queue_t _shared;
+    std::atomic<int> _pending = 0;
+    std::atomic<int> _idle = 0;
+    std::atomic<int> _active = 0;  // workers and spares not blocked
+    int _target = 0;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+
+    static inline int _workers = 0;
+    static inline thread_local int _worker = -1;
+    static inline thread_local bool _pooled = false;
+};
+
 class Future : public Opaque {
 public:
     OPAQUE_PREAMBLE(VM_SUB_BUILTIN, Future, "System", "future");
@@ -24,35 +313,37 @@ public:
         return -1;  // XXX: fix this once
     }
 
-    static VMReduceResult reduce0(VM *vm, const VMObjectPtr &o) {
-        return vm->reduce(o);
-    }
-
     void async(const VMObjectPtr &o) {
         VMObjectPtrs thunk;
         thunk.push_back(o);
         thunk.push_back(machine()->create_none());
         auto app = machine()->create_array(thunk);
+        app->share();
 
-        _future = std::async(std::launch::async, reduce0, machine(), app);
+        _task = std::make_shared<Task>(machine(), app);
+        TaskPool::pool().submit(_task);
     }
 
     VMReduceResult await() {
-        return _future.get();
+        TaskPool::pool().await(_task);
+        _awaited = true;
+        return _task->result();
     }
 
     bool wait_for(int n) {
         std::chrono::milliseconds ms(n);
-        auto status = _future.wait_for(ms);
-        return (status == std::future_status::ready);
+        if (_task->done()) return true;
+        TaskPool::Blocking b;
+        return _task->wait_for(ms);
     }
 
     bool valid() {
-        return _future.valid();
+        return (_task != nullptr) && !_awaited;
     }
 
 protected:
-    std::future<VMReduceResult> _future;
+    TaskPtr _task;
+    std::atomic<bool> _awaited = false;
 };
 
 class Async : public Monadic {
@@ -63,7 +354,7 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         auto vm = machine();
         auto o = Future::create(vm);
-        auto f = std::static_pointer_cast<Future>(o);
+        auto f = vm_ptr_cast<Future>(o);
         f->async(arg0);
         return o;
     }
@@ -133,6 +424,7 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_integer(arg0)) {
             auto n = machine()->get_integer(arg0);
+            TaskPool::Blocking b;
             std::this_thread::sleep_for(std::chrono::milliseconds(n));
             return machine()->create_none();
         } else {
@@ -2,10 +2,12 @@
 
 #include <stdlib.h>
 
+#include <bit>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "runtime.hpp"
 
@@ -15,6 +17,118 @@ typedef std::map<VMObjectPtr, VMObjectPtr, LessVMObjectPtr> dict_t;
 
 const icu::UnicodeString STRING_DICT = "Dict";
 
+// an open addressing table with linear probing on the structural hash of
+// keys; erased entries leave a tombstone until the next rehash. slots are
+// allocated on the first insertion.
+class hashed_dict_t {
+public:
+    size_t size() const {
+        return _size;
+    }
+
+    VMObjectPtr* find(const VMObjectPtr& key) {
+        if (_size == 0) return nullptr;
+        auto i = lookup(key, HashVMObjectPtr()(key));
+        return (_slots[i].state == FULL) ? &_slots[i].value : nullptr;
+    }
+
+    // inserts an empty value for a new key, like std::map
+    VMObjectPtr& operator[](const VMObjectPtr& key) {
+        if (_slots.empty()) {
+            rehash(MIN_CAPACITY);
+        } else if ((_size + _tombstones + 1) * 4 > _slots.size() * 3) {
+            rehash((_size + 1) * 2 > _slots.size() ? _slots.size() * 2
+                                                   : _slots.size());
+        }
+        auto h = HashVMObjectPtr()(key);
+        auto i = lookup(key, h);
+        auto& sl = _slots[i];
+        if (sl.state != FULL) {
+            if (sl.state == TOMBSTONE) _tombstones--;
+            sl.state = FULL;
+            sl.hash = h;
+            sl.key = key;
+            _size++;
+        }
+        return sl.value;
+    }
+
+    void erase(const VMObjectPtr& key) {
+        if (_size == 0) return;
+        auto i = lookup(key, HashVMObjectPtr()(key));
+        auto& sl = _slots[i];
+        if (sl.state == FULL) {
+            sl.state = TOMBSTONE;
+            sl.key = nullptr;
+            sl.value = nullptr;
+            _size--;
+            _tombstones++;
+        }
+    }
+
+    template <typename F>
+    void for_each(F f) const {
+        for (auto& sl : _slots) {
+            if (sl.state == FULL) f(sl.key, sl.value);
+        }
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 8;  // a power of two
+
+    enum state_t : uint8_t { EMPTY, FULL, TOMBSTONE };
+
+    struct slot_t {
+        size_t hash = 0;
+        state_t state = EMPTY;
+        VMObjectPtr key;
+        VMObjectPtr value;
+    };
+
+    // fibonacci hashing spreads sequential keys
+    size_t home(size_t h) const {
+        return (h * 0x9e3779b97f4a7c15ULL) >> (64 - _bits);
+    }
+
+    // the slot holding the key, otherwise the first free slot on its probe
+    size_t lookup(const VMObjectPtr& key, size_t h) const {
+        EqualVMObjectPtr equal;
+        size_t mask = _slots.size() - 1;
+        size_t free = _slots.size();
+        for (size_t i = home(h);; i = (i + 1) & mask) {
+            auto& sl = _slots[i];
+            if (sl.state == EMPTY) {
+                return (free < _slots.size()) ? free : i;
+            } else if (sl.state == TOMBSTONE) {
+                if (free == _slots.size()) free = i;
+            } else if ((sl.hash == h) &&
+                       ((sl.key == key) || equal(sl.key, key))) {
+                return i;
+            }
+        }
+    }
+
+    void rehash(size_t n) {
+        std::vector<slot_t> old(n);
+        old.swap(_slots);
+        _bits = std::countr_zero(n);
+        _tombstones = 0;
+        size_t mask = n - 1;
+        for (auto& sl : old) {
+            if (sl.state == FULL) {
+                auto i = home(sl.hash);
+                while (_slots[i].state != EMPTY) i = (i + 1) & mask;
+                _slots[i] = std::move(sl);
+            }
+        }
+    }
+
+    std::vector<slot_t> _slots;
+    size_t _bits = 0;
+    size_t _size = 0;
+    size_t _tombstones = 0;
+};
+
 int dict_compare(const dict_t& a, const dict_t& b) {
     LessVMObjectPtr cmp;
 
@@ -54,63 +168,118 @@ public:
 
     /*
     Dictionary(const Dictionary& d) : Dictionary(d.machine(), d.value()) {
-        return std::make_shared<Dictionary>(d.machine(), copy(d.value()));
+        return make_vm_ptr<Dictionary>(d.machine(), copy(d.value()));
     }
     */
 
+    Dictionary(VM* m, const hashed_dict_t& d) : Dictionary(m) {
+        _hashed = true;
+        _table = d;
+    }
+
     static VMObjectPtr create(VM* m, const dict_t& d) {
-        return std::make_shared<Dictionary>(m, d);
+        return make_vm_ptr<Dictionary>(m, d);
+    }
+
+    static VMObjectPtr create(VM* m, const hashed_dict_t& d) {
+        return make_vm_ptr<Dictionary>(m, d);
     }
 
     int compare(const VMObjectPtr& o) override {
         if (Dictionary::is_type(o)) {
             auto d = Dictionary::cast(o);
-            return dict_compare(_value, d->value());
+            return dict_compare(value(), d->value());
         } else {
             return -1;
         }
     }
 
+    // a hashed dictionary is ordered here, for comparisons only
     dict_t value() const {
-        return _value;
+        if (_hashed) {
+            dict_t d;
+            _table.for_each([&d](auto& k, auto& v) { d[k] = v; });
+            return d;
+        } else {
+            return _value;
+        }
     }
 
     size_t size() const {
-        return _value.size();
+        return _hashed ? _table.size() : _value.size();
     }
 
     VMObjectPtr copy(const VMObjectPtr& d) {
         auto d1 = Dictionary::cast(d);
-        dict_t cp(d1->value());
-        return Dictionary::create(d1->machine(), cp);
+        if (d1->_hashed) {
+            hashed_dict_t cp(d1->_table);
+            return Dictionary::create(d1->machine(), cp);
+        } else {
+            dict_t cp(d1->value());
+            return Dictionary::create(d1->machine(), cp);
+        }
     }
 
     bool has(const VMObjectPtr key) {
-        return _value.count(key) > 0;
+        if (_hashed) {
+            return _table.find(key) != nullptr;
+        } else {
+            return _value.count(key) > 0;
+        }
     }
 
     VMObjectPtr get(const VMObjectPtr& key) {
-        return _value[key];
+        return _hashed ? _table[key] : _value[key];
     }
 
     void set(const VMObjectPtr& key, const VMObjectPtr& value) {
-        _value[key] = value;
+        if (is_shared()) {
+            share_object(key);
+            share_object(value);
+        }
+        if (_hashed) {
+            _table[key] = value;
+        } else {
+            _value[key] = value;
+        }
+    }
+
+    void shared_children(std::vector<const VMObject*>& oo) const override {
+        auto f = [&oo](auto& k, auto& v) {
+            oo.push_back(k.get());
+            if (v != nullptr) oo.push_back(v.get());
+        };
+        if (_hashed) {
+            _table.for_each(f);
+        } else {
+            for (auto& [k, v] : _value) f(k, v);
+        }
     }
 
     void erase(const VMObjectPtr& key) {
-        _value.erase(key);
+        if (_hashed) {
+            _table.erase(key);
+        } else {
+            _value.erase(key);
+        }
     }
 
     VMObjectPtrs keys() const {
         VMObjectPtrs oo;
-        for (auto& k : _value) {
-            oo.push_back(k.first);
+        if (_hashed) {
+            _table.for_each([&oo](auto& k, auto& v) { oo.push_back(k); });
+        } else {
+            for (auto& k : _value) {
+                oo.push_back(k.first);
+            }
         }
         return oo;
     }
 
 protected:
     dict_t _value;
+    hashed_dict_t _table;
+    bool _hashed = false;
 };
 
 class Dict : public Medadic {
@@ -123,6 +292,18 @@ public:
     }
 };
 
+class DictHashed : public Medadic {
+public:
+    MEDADIC_PREAMBLE(VM_SUB_EGO, DictHashed, STRING_DICT, "dict_hashed");
+
+    DOCSTRING(
+        "Dict::dict_hashed - create a dict object backed by a hash table, "
+        "with unordered keys");
+    VMObjectPtr apply() const override {
+        return Dictionary::create(machine(), hashed_dict_t());
+    }
+};
+
 class DictCopy : public Monadic {
 public:
     MONADIC_PREAMBLE(VM_SUB_EGO, DictCopy, STRING_DICT, "copy");
@@ -255,6 +436,7 @@ public:
         std::vector<VMObjectPtr> oo;
 
         oo.push_back(Dict::create(vm));
+        oo.push_back(DictHashed::create(vm));
         oo.push_back(DictCopy::create(vm));
         oo.push_back(DictHas::create(vm));
         oo.push_back(DictGet::create(vm));
@@ -163,7 +163,7 @@ public:
         if (machine()->is_text(arg0)) {
             auto s = machine()->get_text(arg0);
             auto l = Library::create(machine());
-            (std::static_pointer_cast<Library>(l))->load(s);
+            (vm_ptr_cast<Library>(l))->load(s);
             return l;
         } else {
             throw machine()->bad_args(this, arg0);
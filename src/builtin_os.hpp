@@ -425,7 +425,7 @@ public:
     }
 
     int compare(const VMObjectPtr& o) override {
-        auto v = (std::static_pointer_cast<ChannelValue>(o))->value();
+        auto v = (vm_ptr_cast<ChannelValue>(o))->value();
         if (_value < v)
             return -1;
         else if (v < _value)
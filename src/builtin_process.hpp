@@ -2,11 +2,14 @@
 
 #include <stdlib.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <queue>
 #include <thread>
 
+#include "builtin_async.hpp"
 #include "runtime.hpp"
 
 /**
@@ -17,6 +20,78 @@ namespace egel {
 
 // DOCSTRING("namespace System - process support");
 
+// a bounded message queue; a sender blocks while it is full, a receiver
+// while it is empty. once closed, messages are dropped on push and the
+// ones left can still be popped.
+class Mailbox {
+public:
+    static constexpr size_t CAPACITY = 1024;
+
+    bool push(const VMObjectPtr &o) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wait(_not_full, lock,
+             [this] { return _closed || _queue.size() < CAPACITY; });
+        if (_closed) return false;
+        _queue.push(o);
+        _not_empty.notify_one();
+        return true;
+    }
+
+    // nullptr once closed and empty
+    VMObjectPtr pop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wait(_not_empty, lock, [this] { return _closed || !_queue.empty(); });
+        return take();
+    }
+
+    // nullptr on a timeout as well
+    VMObjectPtr pop_for(std::chrono::milliseconds ms) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        wait(_not_empty, lock, [this] { return _closed || !_queue.empty(); },
+             ms);
+        return take();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _not_empty.notify_all();
+        _not_full.notify_all();
+    }
+
+private:
+    // a task which waits on a mailbox blocks a worker of the task pool
+    template <typename P>
+    static void wait(std::condition_variable &cv,
+                     std::unique_lock<std::mutex> &lock, P p,
+                     std::chrono::milliseconds ms =
+                         std::chrono::milliseconds::max()) {
+        if (p()) return;
+        lock.unlock();
+        TaskPool::Blocking b;
+        lock.lock();
+        if (ms == std::chrono::milliseconds::max()) {
+            cv.wait(lock, p);
+        } else {
+            cv.wait_for(lock, ms, p);
+        }
+    }
+
+    VMObjectPtr take() {
+        if (_queue.empty()) return nullptr;
+        auto o = _queue.front();
+        _queue.pop();
+        _not_full.notify_one();
+        return o;
+    }
+
+    std::queue<VMObjectPtr> _queue;
+    bool _closed = false;
+    std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+};
+
 class Process : public Opaque {
 public:
     OPAQUE_PREAMBLE(VM_SUB_BUILTIN, Process, "System", "process");
@@ -37,7 +112,7 @@ public:
     }
 
     static VMObjectPtr create(VM *vm, const VMObjectPtr &f) {
-        return std::make_shared<Process>(vm, f);
+        return make_vm_ptr<Process>(vm, f);
     }
 
     int compare(const VMObjectPtr &o) override {
@@ -52,47 +127,47 @@ public:
         return _program;
     }
 
+    void shared_children(std::vector<const VMObject *> &oo) const override {
+        if (_program != nullptr) oo.push_back(_program.get());
+    }
+
     void in_push(const VMObjectPtr &o) {
-        _lock.lock();
+        share_object(o);
         _in_queue.push(o);
-        _lock.unlock();
     }
 
     VMObjectPtr in_pop() {
-        VMObjectPtr o = nullptr;
-        _lock.lock();
-        if (!_in_queue.empty()) {
-            o = _in_queue.front();
-            _in_queue.pop();
-        }
-        _lock.unlock();
-        return o;
+        return _in_queue.pop();
     }
 
     void out_push(const VMObjectPtr &o) {
-        _lock.lock();
+        share_object(o);
         _out_queue.push(o);
-        _lock.unlock();
     }
 
     VMObjectPtr out_pop() {
-        VMObjectPtr o = nullptr;
-        _lock.lock();
-        if (!_out_queue.empty()) {
-            o = _out_queue.front();
-            _out_queue.pop();
-        }
-        _lock.unlock();
-        return o;
+        return _out_queue.pop();
     }
 
-    reducer_state_t get_state() const {
-        return _state;
+    VMObjectPtr out_pop_for(std::chrono::milliseconds ms) {
+        return _out_queue.pop_for(ms);
     }
 
+    reducer_state_t get_state() {
+        return std::atomic_ref<reducer_state_t>(_state).load();
+    }
+
+    // a halted process stays halted; halting closes the mailboxes, which
+    // wakes up both the process and its receivers
     void set_state(reducer_state_t s) {
-        if (_state != HALTED) {  // XXX: do I need to lock here?
-            _state = s;
+        std::atomic_ref<reducer_state_t> state(_state);
+        auto t = state.load();
+        while ((t != HALTED) && !state.compare_exchange_weak(t, s)) {
+        }
+        state.notify_all();
+        if (s == HALTED) {
+            _in_queue.close();
+            _out_queue.close();
         }
     }
 
@@ -104,21 +179,21 @@ public:
     }
 
     void set_exception(VMObjectPtr e) {
+        share_object(e);
         _lock.lock();
         _exception = e;
         _lock.unlock();
     }
 
     void run() {
-        symbol_t tup = machine()->enter_symbol("System", "tuple");
+        symbol_t tup = SYMBOL_TUPLE;
 
-        _state = RUNNING;
         VMObjectPtr in = nullptr;
 
-        while (_state != HALTED) {
+        while (get_state() != HALTED) {
             in = in_pop();
             if (in == nullptr) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(25));
+                break;  // halted
             } else {
                 VMObjectPtrs thunk;
                 thunk.push_back(_program);
@@ -130,7 +205,7 @@ public:
                 auto r = machine()->reduce(app, &_state);
 
                 if (r.exception) {
-                    _exception = r.result;
+                    set_exception(r.result);
                     set_state(HALTED);
                 } else {
                     auto t = r.result;
@@ -140,11 +215,11 @@ public:
                             out_push(ff[1]);
                             _program = ff[2];
                         } else {
-                            _exception = VMObjectText::create("no tuple");
+                            set_exception(VMObjectText::create("no tuple"));
                             set_state(HALTED);
                         }
                     } else {
-                        _exception = VMObjectText::create("no tuple");
+                        set_exception(VMObjectText::create("no tuple"));
                         set_state(HALTED);
                     }
                 }
@@ -154,15 +229,15 @@ public:
 
 protected:
     VMObjectPtr _program;
-    std::queue<VMObjectPtr> _in_queue;
-    std::queue<VMObjectPtr> _out_queue;
+    Mailbox _in_queue;
+    Mailbox _out_queue;
     VMObjectPtr _exception;
     std::mutex _lock;
     reducer_state_t _state;
 };
 
 void run_process(const VMObjectPtr &o) {
-    auto process = std::static_pointer_cast<Process>(o);
+    auto process = vm_ptr_cast<Process>(o);
     process->run();
 }
 
@@ -175,6 +250,7 @@ public:
         auto vm = machine();
 
         auto proc = Process::create(vm, arg0);
+        proc->share();  // the process is accessed by both threads
 
         std::thread run(run_process, proc);
 
@@ -191,10 +267,10 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
-        symbol_t pr = machine()->enter_symbol("System", "process");
+        symbol_t pr = SYMBOL_PROCESS;
 
         if ((arg0->tag() == VM_OBJECT_OPAQUE) && (arg0->symbol() == pr)) {
-            auto process = std::static_pointer_cast<Process>(arg0);
+            auto process = vm_ptr_cast<Process>(arg0);
             process->in_push(arg1);
             return machine()->create_none();
         } else {
@@ -209,19 +285,51 @@ public:
     DOCSTRING("System::recv proc - receive a message from process proc");
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
-        symbol_t pr = machine()->enter_symbol("System", "process");
+        symbol_t pr = SYMBOL_PROCESS;
 
         if ((machine()->is_opaque(arg0)) && (arg0->symbol() == pr)) {
-            auto process = std::static_pointer_cast<Process>(arg0);
-            VMObjectPtr msg = nullptr;
-            while ((msg = process->out_pop()) == nullptr) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(25));
-            }
+            auto process = vm_ptr_cast<Process>(arg0);
+            auto msg = process->out_pop();
+            if (msg == nullptr) throw halted(process);
             return msg;
         } else {
             throw machine()->bad_args(this, arg0);
         }
     }
+
+    static VMObjectPtr halted(const vm_ptr<Process> &process) {
+        auto e = process->get_exception();
+        return (e == nullptr) ? VMObjectText::create("halted") : e;
+    }
+};
+
+class RecvFor : public Dyadic {
+public:
+    DYADIC_PREAMBLE(VM_SUB_BUILTIN, RecvFor, "System", "recv_for");
+    DOCSTRING(
+        "System::recv_for proc n - receive a message from process proc "
+        "within n milliseconds, or none");
+
+    VMObjectPtr apply(const VMObjectPtr &arg0,
+                      const VMObjectPtr &arg1) const override {
+        symbol_t pr = SYMBOL_PROCESS;
+
+        if ((machine()->is_opaque(arg0)) && (arg0->symbol() == pr) &&
+            (machine()->is_integer(arg1))) {
+            auto process = vm_ptr_cast<Process>(arg0);
+            auto n = machine()->get_integer(arg1);
+            auto msg = process->out_pop_for(std::chrono::milliseconds(n));
+            if (msg != nullptr) {
+                return msg;
+            } else if (process->get_state() == HALTED) {
+                throw Recv::halted(process);
+            } else {
+                return machine()->create_none();
+            }
+        } else {
+            throw machine()->bad_args(this, arg0, arg1);
+        }
+    }
 };
 
 class Halt : public Monadic {
@@ -230,10 +338,10 @@ public:
     DOCSTRING("System::halt proc - halt process proc");
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
-        symbol_t pr = machine()->enter_symbol("System", "process");
+        symbol_t pr = SYMBOL_PROCESS;
 
         if ((machine()->is_opaque(arg0)) && (arg0->symbol() == pr)) {
-            auto process = std::static_pointer_cast<Process>(arg0);
+            auto process = vm_ptr_cast<Process>(arg0);
             process->set_state(HALTED);
             return machine()->create_none();
         } else {
@@ -262,6 +370,7 @@ public:
         oo.push_back(Proc::create(vm));
         oo.push_back(Send::create(vm));
         oo.push_back(Recv::create(vm));
+        oo.push_back(RecvFor::create(vm));
         oo.push_back(Halt::create(vm));
 
         return oo;
@@ -26,7 +26,7 @@ VMObjectPtr strings_to_list(VM* vm, UnicodeStrings ss) {
 }
 
 class Regex;
-typedef std::shared_ptr<Regex> RegexPtr;
+typedef vm_ptr<Regex> RegexPtr;
 
 class Regex : public Opaque {
 public:
@@ -49,7 +49,7 @@ public:
 
     int compare(const VMObjectPtr& o) override {
         if ((machine()->is_opaque(o)) && (o->symbol() == this->symbol())) {
-            RegexPtr r = std::static_pointer_cast<Regex>(o);
+            RegexPtr r = vm_ptr_cast<Regex>(o);
             if (string() < r->string()) {
                 return -1;
             } else if (r->string() < string()) {
@@ -99,7 +99,7 @@ public:
     }
 
     static RegexPtr regex_pattern_cast(const VMObjectPtr& o) {
-        return std::static_pointer_cast<Regex>(o);
+        return vm_ptr_cast<Regex>(o);
     }
 
 private:
@@ -113,7 +113,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr& arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s0 = machine()->get_text(arg0);
+            auto &s0 = machine()->get_text(arg0);
             UParseError parse_error;
             UErrorCode error_code = U_ZERO_ERROR;
             icu::UnicodeString pat = s0;
@@ -140,7 +140,7 @@ public:
                       const VMObjectPtr& arg1) const override {
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg1);
 
             auto r = pat->matcher(s0);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1);
@@ -167,7 +167,7 @@ public:
                       const VMObjectPtr& arg1) const override {
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg1);
 
             auto r = pat->matcher(s0);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1);
@@ -193,7 +193,7 @@ public:
                       const VMObjectPtr& arg1) const override {
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg1);
 
             auto r = pat->matcher(s0);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1);
@@ -223,12 +223,13 @@ public:
                       const VMObjectPtr& arg1) const override {
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg1);
 
             auto r = pat->matcher(s0);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1);
 
-            UnicodeStrings ss;
+            // the parts are slices of the text
+            VMObjectPtrs ss;
             int32_t pos = 0;
             int32_t start = 0;
             int32_t end = 0;
@@ -237,18 +238,16 @@ public:
                 start = r->start(error_code);
                 end = r->end(error_code);
 
-                icu::UnicodeString s;
-                s0.extract(pos, start - pos, s);
-                ss.push_back(s);
+                ss.push_back(
+                    machine()->create_text_slice(arg1, pos, start - pos));
 
                 pos = end;
             }
-            icu::UnicodeString s;
-            s0.extract(pos, s0.length() - pos, s);
-            ss.push_back(s);
+            ss.push_back(
+                machine()->create_text_slice(arg1, pos, s0.length() - pos));
             delete r;
 
-            return strings_to_list(machine(), ss);
+            return machine()->to_list(ss);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
         }
@@ -264,24 +263,23 @@ public:
                       const VMObjectPtr& arg1) const override {
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg1);
 
             auto r = pat->matcher(s0);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1);
 
-            UnicodeStrings ss;
+            VMObjectPtrs ss;
             while (r->find()) {
                 UErrorCode error_code = U_ZERO_ERROR;
                 auto start = r->start(error_code);
                 auto end = r->end(error_code);
 
-                icu::UnicodeString s;
-                s0.extract(start, end - start, s);
-                ss.push_back(s);
+                ss.push_back(
+                    machine()->create_text_slice(arg1, start, end - start));
             }
             delete r;
 
-            return strings_to_list(machine(), ss);
+            return machine()->to_list(ss);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
         }
@@ -299,8 +297,8 @@ public:
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1)) &&
             (machine()->is_text(arg2))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
-            auto s1 = machine()->get_text(arg2);
+            auto &s0 = machine()->get_text(arg1);
+            auto &s1 = machine()->get_text(arg2);
 
             auto r = pat->matcher(s1);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1, arg2);
@@ -331,8 +329,8 @@ public:
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1)) &&
             (machine()->is_text(arg2))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
-            auto s1 = machine()->get_text(arg2);
+            auto &s0 = machine()->get_text(arg1);
+            auto &s1 = machine()->get_text(arg2);
 
             auto r = pat->matcher(s1);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1, arg2);
@@ -361,7 +359,7 @@ public:
                       const VMObjectPtr& arg1) const override {
         if ((Regex::is_regex_pattern(arg0)) && (machine()->is_text(arg1))) {
             auto pat = Regex::regex_pattern_cast(arg0);
-            auto s0 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg1);
 
             auto r = pat->matcher(s0);
             if (r == nullptr) throw machine()->bad_args(this, arg0, arg1);
@@ -74,6 +74,54 @@ public:
     }
 };
 
+// binary serializations are carried as texts of which each character
+// is a byte, i.e., lies in the range 0-255
+
+class SerializeBinary : public Monadic {
+public:
+    MONADIC_PREAMBLE(VM_SUB_BUILTIN, SerializeBinary, "System",
+                     "serialize_binary");
+    DOCSTRING(
+        "System::serialize_binary t - serialize a term to a text of bytes");
+
+    VMObjectPtr apply(const VMObjectPtr &arg0) const override {
+        auto m = machine();
+        auto b = m->serialize_binary(arg0);
+        icu::UnicodeString s;
+        auto buffer = s.getBuffer(b.size());
+        for (size_t i = 0; i < b.size(); i++) {
+            buffer[i] = (uint8_t)b[i];
+        }
+        s.releaseBuffer(b.size());
+        return m->create_text(s);
+    }
+};
+
+class DeserializeBinary : public Monadic {
+public:
+    MONADIC_PREAMBLE(VM_SUB_BUILTIN, DeserializeBinary, "System",
+                     "deserialize_binary");
+    DOCSTRING(
+        "System::deserialize_binary t - deserialize a text of bytes to a "
+        "term");
+
+    VMObjectPtr apply(const VMObjectPtr &arg0) const override {
+        auto m = machine();
+        if (m->is_text(arg0)) {
+            auto &s = VMObjectText::cast(arg0)->value_ref();
+            std::string b(s.length(), 0);
+            for (int i = 0; i < s.length(); i++) {
+                auto c = s.charAt(i);
+                if (c > 0xff) throw m->bad_args(this, arg0);
+                b[i] = (char)c;
+            }
+            return m->deserialize_binary(b);
+        } else {
+            throw m->bad_args(this, arg0);
+        }
+    }
+};
+
 class Docstring : public Monadic {
 public:
     MONADIC_PREAMBLE(VM_SUB_BUILTIN, Docstring, "System", "docstring");
@@ -318,6 +366,45 @@ public:
     }
 };
 
+class PoolStats : public Medadic {
+public:
+    MEDADIC_PREAMBLE(VM_SUB_BUILTIN, PoolStats, "System", "pool_stats");
+    DOCSTRING(
+        "System::pool_stats - list of (size, hits, misses) of the object "
+        "pools");
+
+    VMObjectPtr apply() const override {
+        VMObjectPtrs oo;
+        for (size_t c = 0; c < VMPool::CLASSES; c++) {
+            auto st = VMPool::stats(c);
+            if (st.hits + st.misses > 0) {
+                VMObjectPtrs tt;
+                tt.push_back(machine()->create_integer(VMPool::class_size(c)));
+                tt.push_back(machine()->create_integer(st.hits));
+                tt.push_back(machine()->create_integer(st.misses));
+                oo.push_back(machine()->to_tuple(tt));
+            }
+        }
+        return machine()->to_list(oo);
+    }
+};
+
+class FrameStats : public Medadic {
+public:
+    MEDADIC_PREAMBLE(VM_SUB_BUILTIN, FrameStats, "System", "frame_stats");
+    DOCSTRING(
+        "System::frame_stats - (reused, allocated) count of thunk frames of "
+        "this thread");
+
+    VMObjectPtr apply() const override {
+        auto st = VMObjectArray::frame_stats();
+        VMObjectPtrs tt;
+        tt.push_back(machine()->create_integer(st.reused));
+        tt.push_back(machine()->create_integer(st.allocated));
+        return machine()->to_tuple(tt);
+    }
+};
+
 class Dependencies : public Monadic {
 public:
     MONADIC_PREAMBLE(VM_SUB_BUILTIN, Dependencies, "System", "dependencies");
@@ -427,6 +514,8 @@ public:
 
         oo.push_back(Serialize::create(vm));
         oo.push_back(Deserialize::create(vm));
+        oo.push_back(SerializeBinary::create(vm));
+        oo.push_back(DeserializeBinary::create(vm));
 
         oo.push_back(Tokenize::create(vm));
 
@@ -455,6 +544,8 @@ public:
         oo.push_back(Dependencies::create(vm));
 
         oo.push_back(DebugPtr::create(vm));
+        oo.push_back(PoolStats::create(vm));
+        oo.push_back(FrameStats::create(vm));
 
         return oo;
     }
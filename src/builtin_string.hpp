@@ -21,8 +21,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s0 == s1);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -38,8 +38,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s0 != s1);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -55,8 +55,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s0 > s1);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -72,8 +72,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s0 < s1);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -89,8 +89,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s0 >= s1);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -106,8 +106,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s0 <= s1);
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -123,8 +123,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_integer(s0.compare(s1));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -141,8 +141,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_integer(s0.compareCodePointOrder(s1));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -159,8 +159,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_integer(
                 s0.caseCompare(s1, U_FOLD_CASE_DEFAULT));
         } else {
@@ -180,12 +180,7 @@ public:
             (machine()->is_text(arg2))) {
             auto n0 = machine()->get_integer(arg0);
             auto n1 = machine()->get_integer(arg1);
-            auto s = machine()->get_text(arg2);
-            UnicodeString r;
-
-            s.extract(n0, n1, r);
-
-            return machine()->create_text(r);
+            return machine()->create_text_slice(arg2, n0, n1);
         } else {
             throw machine()->bad_args(this, arg0, arg1, arg2);
         }
@@ -200,8 +195,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s1.startsWith(s0));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -217,8 +212,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_bool(s1.endsWith(s0));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -234,8 +229,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_integer(s1.indexOf(s0));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -251,8 +246,8 @@ public:
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_integer(s1.lastIndexOf(s0));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -269,7 +264,7 @@ public:
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_integer(arg0)) && (machine()->is_text(arg1))) {
             auto n = machine()->get_integer(arg0);
-            auto s = machine()->get_text(arg1);
+            auto &s = machine()->get_text(arg1);
             return machine()->create_char(s.char32At(n));
         } else {
             throw machine()->bad_args(this, arg0, arg1);
@@ -288,7 +283,7 @@ public:
             (machine()->is_text(arg2))) {
             auto n = machine()->get_integer(arg0);
             auto d = machine()->get_integer(arg1);
-            auto s = machine()->get_text(arg2);
+            auto &s = machine()->get_text(arg2);
             return machine()->create_integer(s.moveIndex32(n, d));
         } else {
             throw machine()->bad_args(this, arg0, arg1, arg2);
@@ -303,7 +298,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s = machine()->get_text(arg0);
+            auto &s = machine()->get_text(arg0);
             return machine()->create_integer(s.countChar32());
         } else {
             throw machine()->bad_args(this, arg0);
@@ -318,7 +313,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s = machine()->get_text(arg0);
+            auto &s = machine()->get_text(arg0);
             return machine()->create_bool(s.isEmpty());
         } else {
             throw machine()->bad_args(this, arg0);
@@ -333,7 +328,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s = machine()->get_text(arg0);
+            auto &s = machine()->get_text(arg0);
             return machine()->create_integer(s.hashCode());
         } else {
             throw machine()->bad_args(this, arg0);
@@ -350,7 +345,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s = machine()->get_text(arg0);
+            auto &s = machine()->get_text(arg0);
             return machine()->create_bool(s.isBogus());
         } else {
             throw machine()->bad_args(this, arg0);
@@ -367,7 +362,7 @@ public:
                       const VMObjectPtr &arg1) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1))) {
             auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s1 = machine()->get_text(arg1);
             return machine()->create_text(s0.append(s1));
         } else if ((machine()->is_text(arg0)) && (machine()->is_char(arg1))) {
             auto s0 = machine()->get_text(arg0);
@@ -388,7 +383,7 @@ public:
                       const VMObjectPtr &arg2) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_integer(arg1)) &&
             (machine()->is_text(arg2))) {
-            auto s0 = machine()->get_text(arg0);
+            auto &s0 = machine()->get_text(arg0);
             auto n = machine()->get_integer(arg1);
             auto s1 = machine()->get_text(arg2);
             return machine()->create_text(s1.insert(n, s0));
@@ -407,8 +402,8 @@ public:
                       const VMObjectPtr &arg2) const override {
         if ((machine()->is_text(arg0)) && (machine()->is_text(arg1)) &&
             (machine()->is_text(arg2))) {
-            auto s0 = machine()->get_text(arg0);
-            auto s1 = machine()->get_text(arg1);
+            auto &s0 = machine()->get_text(arg0);
+            auto &s1 = machine()->get_text(arg1);
             auto s2 = machine()->get_text(arg2);
             return machine()->create_text(s2.findAndReplace(s0, s1));
         } else {
@@ -447,8 +442,10 @@ public:
             (machine()->is_text(arg2))) {
             auto n0 = machine()->get_integer(arg0);
             auto n1 = machine()->get_integer(arg1);
-            auto s0 = machine()->get_text(arg2);
-            return machine()->create_text(s0.retainBetween(n0, n1));
+            auto &s0 = machine()->get_text(arg2);
+            n1 = std::clamp<vm_int_t>(n1, 0, s0.length());
+            n0 = std::clamp<vm_int_t>(n0, 0, n1);
+            return machine()->create_text_slice(arg2, n0, n1 - n0);
         } else {
             throw machine()->bad_args(this, arg0, arg1, arg2);
         }
@@ -462,8 +459,20 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s = machine()->get_text(arg0);
-            return machine()->create_text(s.trim());
+            // whitespace as icu's trim has it
+            auto &s = machine()->get_text(arg0);
+            auto space = [](UChar32 c) {
+                return (c == 0x20) || u_isWhitespace(c);
+            };
+            int32_t i = 0;
+            int32_t j = s.length();
+            while ((i < j) && space(s.char32At(i))) {
+                i = s.moveIndex32(i, 1);
+            }
+            while ((j > i) && space(s.char32At(s.moveIndex32(j, -1)))) {
+                j = s.moveIndex32(j, -1);
+            }
+            return machine()->create_text_slice(arg0, i, j - i);
         } else {
             throw machine()->bad_args(this, arg0);
         }
@@ -539,7 +548,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto s = machine()->get_text(arg0);
+            auto &s = machine()->get_text(arg0);
             return machine()->create_text(s.unescape());
         } else {
             throw machine()->bad_args(this, arg0);
@@ -584,7 +593,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         if (machine()->is_text(arg0)) {
-            auto str = machine()->get_text(arg0);
+            auto &str = machine()->get_text(arg0);
 
             VMObjectPtrs ss;
             for (int i = 0; i < str.length(); i = str.moveIndex32(i, 1)) {
@@ -605,11 +614,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0) const override {
         // rewrite to use machine()->is_nil
-        static symbol_t _nil = 0;
-        if (_nil == 0) _nil = machine()->enter_symbol("System", "nil");
-
-        static symbol_t _cons = 0;
-        if (_cons == 0) _cons = machine()->enter_symbol("System", "cons");
+        symbol_t _cons = SYMBOL_CONS;
 
         icu::UnicodeString ss;
         auto a = arg0;
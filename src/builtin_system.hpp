@@ -522,8 +522,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0,
                       const VMObjectPtr &arg1) const override {
-        static symbol_t object = 0;
-        if (object == 0) object = machine()->enter_symbol("System", "object");
+        symbol_t object = SYMBOL_OBJECT;
 
         if (machine()->is_array(arg1)) {
             auto ff = machine()->get_array(arg1);
@@ -558,8 +557,7 @@ public:
 
     VMObjectPtr apply(const VMObjectPtr &arg0, const VMObjectPtr &arg1,
                       const VMObjectPtr &arg2) const override {
-        static symbol_t object = 0;
-        if (object == 0) object = machine()->enter_symbol("System", "object");
+        symbol_t object = SYMBOL_OBJECT;
 
         if (machine()->is_array(arg2)) {
             auto ff = machine()->get_array(arg2);
@@ -791,9 +789,14 @@ public:
     }
 
     void set_ref(const VMObjectPtr &r) {
+        if (is_shared()) share_object(r);
         _ref = r;
     }
 
+    void shared_children(std::vector<const VMObject *> &oo) const override {
+        if (_ref != nullptr) oo.push_back(_ref.get());
+    }
+
 protected:
     VMObjectPtr _ref = nullptr;
 };
@@ -43,7 +43,7 @@ public:
 
     static VMObjectPtr create(VM* m,
                               const std::chrono::duration<int, std::milli>& d) {
-        auto o = std::make_shared<Duration>(m);
+        auto o = make_vm_ptr<Duration>(m);
         o->set_duration(d);
         return o;
     }
@@ -119,14 +119,14 @@ public:
 
     static VMObjectPtr create_system(
         VM* m, const std::chrono::time_point<std::chrono::system_clock>& tp) {
-        auto o = std::make_shared<TimePoint>(m);
+        auto o = make_vm_ptr<TimePoint>(m);
         o->set_time_point_system_clock(tp);
         return o;
     }
 
     static VMObjectPtr create_steady(
         VM* m, const std::chrono::time_point<std::chrono::steady_clock>& tp) {
-        auto o = std::make_shared<TimePoint>(m);
+        auto o = make_vm_ptr<TimePoint>(m);
         o->set_time_point_steady_clock(tp);
         return o;
     }
@@ -134,7 +134,7 @@ public:
     static VMObjectPtr create_high_resolution(
         VM* m,
         const std::chrono::time_point<std::chrono::high_resolution_clock>& tp) {
-        auto o = std::make_shared<TimePoint>(m);
+        auto o = make_vm_ptr<TimePoint>(m);
         o->set_time_point_high_resolution_clock(tp);
         return o;
     }
@@ -520,7 +520,7 @@ public:
     }
 
     static VMObjectPtr create(VM* m, const clock_type& tp) {
-        auto tc = std::make_shared<TimeClock>(m);
+        auto tc = make_vm_ptr<TimeClock>(m);
         tc->set_clock_type(tp);
         return tc;
     }
@@ -641,7 +641,7 @@ public:
     }
 
     static VMObjectPtr create(VM* m, const std::tm d) {
-        auto o = std::make_shared<Date>(m);
+        auto o = make_vm_ptr<Date>(m);
         o->set_date(d);
         return o;
     }
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <set>
 #include <sstream>
 #include <tuple>
 #include <vector>
@@ -35,8 +38,155 @@ enum opcode_t {
     OP_TAG,      //  x y         flag := (x, or x[0], == y)
     OP_FAIL,     //  l           pc := l, if flag
     OP_RETURN,   //  x           return x
+    OP_PRIM,     //  x y z i16   x := [ y,.., z ], or reduce primitive i
+    OP_LOOP,     //  x           r0, pc := x, 0 on a self call, or return x
 };
 
+/*
+    A saturated call of an arithmetic, bitwise, or comparison builtin on
+    values, two variables or constants, is emitted as a prim instruction.
+    Its registers y,..,z hold the thunk [rt rti k exc f a0 a1], and it either
+    evaluates the primitive in place, setting rt[rti] and returning k as the
+    continuation, or builds the thunk as an array would for the builtin to
+    handle other operands, overflow, and division by zero.
+
+    A clause which ends in a call to the combinator itself ends with a loop
+    instruction instead of a return. When the continuation it is given is
+    still that call, a thunk of the combinator, it becomes the thunk of the
+    reduction and the combinator restarts on it without going through the
+    trampoline. When it is a call which computes an argument of that call
+    first, as in foldl, that is reduced in place, and so are the thunks it
+    continues with, until one is the self call. Native code returns either
+    to the trampoline.
+*/
+enum prim_t {
+    PRIM_ADD,
+    PRIM_SUB,
+    PRIM_MUL,
+    PRIM_DIV,
+    PRIM_MOD,
+    PRIM_AND,
+    PRIM_OR,
+    PRIM_XOR,
+    PRIM_SHL,
+    PRIM_SHR,
+    PRIM_LT,
+    PRIM_LE,
+    PRIM_GT,
+    PRIM_GE,
+    PRIM_EQ,
+    PRIM_NE,
+    PRIM_NONE,
+};
+
+// the primitive of a builtin, PRIM_NONE if there is none
+inline prim_t prim_from_text(const icu::UnicodeString &s) {
+    static const char *const texts[] = {
+        "System::+",  "System::-",  "System::*", "System::/",
+        "System::%",  "System::&",  "System::$", "System::^",
+        "System::<<", "System::>>", "System::<", "System::<=",
+        "System::>",  "System::>=", "System::==", "System::/=",
+    };
+    for (int n = 0; n < PRIM_NONE; n++) {
+        if (s == texts[n]) return (prim_t)n;
+    }
+    return PRIM_NONE;
+}
+
+// the primitive applied to two integers or two floats as the builtin would,
+// null where the builtin should decide. native code knows the primitive when
+// it is emitted and passes it as a constant, the switches then fold
+template <typename P>
+inline VMObjectPtr prim_apply(VM *m, const P p, const VMObjectPtr &a0,
+                              const VMObjectPtr &a1) {
+    if (VMObjectInteger::test(a0) && VMObjectInteger::test(a1)) {
+        auto i0 = VMObjectInteger::value(a0);
+        auto i1 = VMObjectInteger::value(a1);
+        vm_int_t r;
+        switch (p) {
+            case PRIM_ADD:
+                if (__builtin_add_overflow(i0, i1, &r)) return nullptr;
+                break;
+            case PRIM_SUB:
+                if (__builtin_sub_overflow(i0, i1, &r)) return nullptr;
+                break;
+            case PRIM_MUL:
+                if (__builtin_mul_overflow(i0, i1, &r)) return nullptr;
+                break;
+            case PRIM_DIV:
+                if (i1 == 0) return nullptr;
+                r = i0 / i1;
+                break;
+            case PRIM_MOD:
+                if (i1 == 0) return nullptr;
+                r = i0 % i1;
+                break;
+            case PRIM_AND:
+                r = i0 & i1;
+                break;
+            case PRIM_OR:
+                r = i0 | i1;
+                break;
+            case PRIM_XOR:
+                r = i0 ^ i1;
+                break;
+            case PRIM_SHL:
+                r = i0 << i1;
+                break;
+            case PRIM_SHR:
+                r = i0 >> i1;
+                break;
+            case PRIM_LT:
+                return m->create_bool(i0 < i1);
+            case PRIM_LE:
+                return m->create_bool(i0 <= i1);
+            case PRIM_GT:
+                return m->create_bool(i0 > i1);
+            case PRIM_GE:
+                return m->create_bool(i0 >= i1);
+            case PRIM_EQ:
+                return m->create_bool(i0 == i1);
+            case PRIM_NE:
+                return m->create_bool(i0 != i1);
+            default:
+                return nullptr;
+        }
+        return VMObjectInteger::create(r);
+    } else if (VMObjectFloat::test(a0) && VMObjectFloat::test(a1)) {
+        // comparisons order floats as compare does, NaNs last
+        auto f0 = VMObjectFloat::value(a0);
+        auto f1 = VMObjectFloat::value(a1);
+        auto c = CompareVMObjectPtr::compare_float;
+        switch (p) {
+            case PRIM_ADD:
+                return VMObjectFloat::create(f0 + f1);
+            case PRIM_SUB:
+                return VMObjectFloat::create(f0 - f1);
+            case PRIM_MUL:
+                return VMObjectFloat::create(f0 * f1);
+            case PRIM_DIV:
+                if (f1 == 0.0) return nullptr;
+                return VMObjectFloat::create(f0 / f1);
+            case PRIM_LT:
+                return m->create_bool(c(f0, f1) < 0);
+            case PRIM_LE:
+                return m->create_bool(c(f0, f1) <= 0);
+            case PRIM_GT:
+                return m->create_bool(c(f0, f1) > 0);
+            case PRIM_GE:
+                return m->create_bool(c(f0, f1) >= 0);
+            case PRIM_EQ:
+                return m->create_bool(c(f0, f1) == 0);
+            case PRIM_NE:
+                return m->create_bool(c(f0, f1) != 0);
+            default:
+                return nullptr;
+        }
+    } else {
+        return nullptr;
+    }
+}
+
 using Code = std::vector<uint8_t>;
 using Data = std::vector<uint32_t>;  // XXX this is overkil after a change to a
                                      // data section
@@ -200,6 +350,15 @@ public:
         emit_idx(i);
     }
 
+    void emit_op_prim(const reg_t x, const reg_t y, const reg_t z,
+                      const index_t i) {
+        emit_op(OP_PRIM);
+        emit_reg(x);
+        emit_reg(y);
+        emit_reg(z);
+        emit_idx(i);
+    }
+
     void emit_op_test(const reg_t x, const reg_t y) {
         emit_op(OP_TEST);
         emit_reg(x);
@@ -222,6 +381,11 @@ public:
         emit_reg(x);
     }
 
+    void emit_op_loop(const reg_t x) {
+        emit_op(OP_LOOP);
+        emit_reg(x);
+    }
+
     void emit_label(const label_t l) {
         _labels[l] = _code.size();
     }
@@ -252,6 +416,7 @@ public:
                     break;
                 case OP_TAKEX:
                 case OP_CONCATX:
+                case OP_PRIM:
                     pc += OP_SIZE + 3 * OP_REG_SIZE + OP_INDEX_SIZE;
                     break;
                 case OP_SPLIT:
@@ -274,6 +439,7 @@ public:
                     pc += OP_LABEL_SIZE;
                 } break;
                 case OP_RETURN:
+                case OP_LOOP:
                     pc += OP_SIZE + 1 * OP_REG_SIZE;
                     break;
                 default:
@@ -309,75 +475,367 @@ private:
 #define FETCH_idx(c, pc) FETCH_i16(c, pc)
 #define FETCH_lbl(c, pc) FETCH_i32(c, pc)
 
+// the registers of a reduction, on the stack unless a combinator uses
+// many of them
 class Registers {
 public:
-    Registers() {
+    explicit Registers(size_t n) : _size(n) {
+        if (n <= LOCAL_REGISTERS) {
+            _reg = reinterpret_cast<VMObjectPtr *>(_local);
+        } else {
+            _reg = static_cast<VMObjectPtr *>(
+                ::operator new(n * sizeof(VMObjectPtr)));
+        }
+        std::uninitialized_value_construct_n(_reg, n);
     }
 
-    const VMObjectPtr get(const reg_t n) {
-        if (n < MAX_REGISTERS) {
-            return _fast[n];
-        } else {
-            return _fallback[n];
+    Registers(const Registers &) = delete;
+    Registers &operator=(const Registers &) = delete;
+
+    ~Registers() {
+        std::destroy_n(_reg, _size);
+        if (_reg != reinterpret_cast<VMObjectPtr *>(_local)) {
+            ::operator delete(_reg);
         }
     }
 
-    void set(const reg_t n, const VMObjectPtr &o) {
-        if (n < MAX_REGISTERS) {
-            _fast[n] = o;
-        } else {
-            _fallback[n] = o;
+    VMObjectPtr &operator[](const reg_t n) {
+        return _reg[n];
+    }
+
+    // drop what the registers hold
+    void clear() {
+        for (size_t n = 0; n < _size; n++) {
+            _reg[n] = nullptr;
         }
     }
 
-    const VMObjectPtr operator[](const reg_t n) {
-        return get(n);
+private:
+    static const size_t LOCAL_REGISTERS = 32;
+
+    size_t _size;
+    VMObjectPtr *_reg;
+    alignas(VMObjectPtr) std::byte _local[LOCAL_REGISTERS * sizeof(VMObjectPtr)];
+};
+
+// the constants of a combinator resolved from the data table, shared by the
+// interpreter and native code which loads them by address, the machine
+// patches them when a data entry is redefined. that happens while other
+// threads reduce, e.g., when hot bytecode is compiled lazily, so the slots
+// are atomic. they hold raw pointers since data table entries are immortal
+class Constants {
+public:
+    using slot_t = std::atomic<VMObject *>;
+
+    Constants(VM *m, const Data &d) : _data(d), _objects(d.size()) {
+        for (size_t n = 0; n < d.size(); n++) {
+            _objects[n].store(m->get_data(d[n]).get(),
+                              std::memory_order_relaxed);
+        }
+    }
+
+    Constants(const Constants &) = delete;
+    Constants &operator=(const Constants &) = delete;
+
+    VMObjectPtr operator[](const uint32_t n) const {
+        return VMObjectPtr(_objects[n].load(std::memory_order_acquire));
+    }
+
+    const slot_t *address(const uint32_t n) const {
+        return &_objects[n];
+    }
+
+    // the entries for data d now hold o, which the data table keeps alive
+    void patch(const data_t d, const VMObjectPtr &o) {
+        for (size_t n = 0; n < _data.size(); n++) {
+            if (_data[n] == d) {
+                _objects[n].store(o.get(), std::memory_order_release);
+            }
+        }
     }
 
 private:
-    static const int MAX_REGISTERS = 64;
+    Data _data;
+    std::vector<slot_t> _objects;
+};
+
+static_assert(sizeof(Constants::slot_t) == sizeof(VMObjectPtr));
+
+using ConstantsPtr = std::shared_ptr<Constants>;
 
-    VMObjectPtr _fast[MAX_REGISTERS];
-    std::map<reg_t, VMObjectPtr> _fallback;
+// the bytecode as the interpreter runs it: opcodes and operands widened to
+// words, and labels translated to word offsets
+struct Decoded {
+    std::vector<uint32_t> words;
+    uint32_t registers = 1;
 };
 
+inline Decoded decode(const Code &c) {
+    Decoded t;
+    std::map<uint32_t, uint32_t> offsets;
+    std::vector<size_t> labels;
+    reg_t top = 0;
+    auto reg = [&](const reg_t r) {
+        top = std::max(top, r);
+        t.words.push_back(r);
+    };
+
+    uint32_t pc = 0;
+    while (pc < c.size()) {
+        offsets[pc] = t.words.size();
+        uint8_t op = FETCH_op(c, pc);
+        t.words.push_back(op);
+        switch (op) {
+            case OP_NIL:
+            case OP_RETURN:
+            case OP_LOOP: {
+                reg_t x = FETCH_reg(c, pc);
+                reg(x);
+            } break;
+            case OP_MOV:
+            case OP_TEST:
+            case OP_TAG: {
+                reg_t x = FETCH_reg(c, pc);
+                reg_t y = FETCH_reg(c, pc);
+                reg(x);
+                reg(y);
+            } break;
+            case OP_DATA: {
+                reg_t x = FETCH_reg(c, pc);
+                uint32_t i32 = FETCH_i32(c, pc);
+                reg(x);
+                t.words.push_back(i32);
+            } break;
+            case OP_SET:
+            case OP_SPLIT:
+            case OP_ARRAY: {
+                reg_t x = FETCH_reg(c, pc);
+                reg_t y = FETCH_reg(c, pc);
+                reg_t z = FETCH_reg(c, pc);
+                reg(x);
+                reg(y);
+                reg(z);
+            } break;
+            case OP_TAKEX:
+            case OP_CONCATX:
+            case OP_PRIM: {
+                reg_t x = FETCH_reg(c, pc);
+                reg_t y = FETCH_reg(c, pc);
+                reg_t z = FETCH_reg(c, pc);
+                index_t i = FETCH_idx(c, pc);
+                reg(x);
+                reg(y);
+                reg(z);
+                t.words.push_back(i);
+            } break;
+            case OP_FAIL: {
+                label_t l = FETCH_lbl(c, pc);
+                labels.push_back(t.words.size());
+                t.words.push_back(l);
+            } break;
+            default:
+                PANIC("decode case");
+                break;
+        }
+    }
+    offsets[pc] = t.words.size();
+
+    for (auto l : labels) {
+        t.words[l] = offsets[t.words[l]];
+    }
+    t.registers = top + 1;
+    return t;
+}
+
+// the most registers code which isn't generated locally may use, large
+// literals take a register per element
+constexpr reg_t MAX_REGISTERS = 1 << 24;
+
+// whether code from elsewhere decodes: known opcodes with all their
+// operands, registers and constants in range, labels on instructions, and
+// no falling off the end
+inline bool well_formed(const Code &c, const size_t data) {
+    std::set<uint32_t> starts;
+    std::vector<label_t> labels;
+    bool ok = true;
+    auto fits = [&](const uint32_t pc, const size_t n) {
+        return n <= c.size() - pc;
+    };
+    auto reg = [&](const reg_t r) { ok = ok && (r < MAX_REGISTERS); };
+
+    uint32_t pc = 0;
+    uint8_t op = OP_FAIL;
+    while (ok && pc < c.size()) {
+        starts.insert(pc);
+        op = FETCH_op(c, pc);
+        switch (op) {
+            case OP_NIL:
+            case OP_RETURN:
+            case OP_LOOP:
+                if (!fits(pc, OP_REG_SIZE)) return false;
+                {
+                    reg_t x = FETCH_reg(c, pc);
+                    reg(x);
+                }
+                break;
+            case OP_MOV:
+            case OP_TEST:
+            case OP_TAG:
+                if (!fits(pc, 2 * OP_REG_SIZE)) return false;
+                {
+                    reg_t x = FETCH_reg(c, pc);
+                    reg_t y = FETCH_reg(c, pc);
+                    reg(x);
+                    reg(y);
+                }
+                break;
+            case OP_DATA:
+                if (!fits(pc, OP_REG_SIZE + OP_INT_SIZE)) return false;
+                {
+                    reg_t x = FETCH_reg(c, pc);
+                    uint32_t i32 = FETCH_i32(c, pc);
+                    reg(x);
+                    ok = ok && (i32 < data);
+                }
+                break;
+            case OP_SET:
+            case OP_SPLIT:
+            case OP_ARRAY:
+                if (!fits(pc, 3 * OP_REG_SIZE)) return false;
+                {
+                    reg_t x = FETCH_reg(c, pc);
+                    reg_t y = FETCH_reg(c, pc);
+                    reg_t z = FETCH_reg(c, pc);
+                    reg(x);
+                    reg(y);
+                    reg(z);
+                }
+                break;
+            case OP_TAKEX:
+            case OP_CONCATX:
+            case OP_PRIM:
+                if (!fits(pc, 3 * OP_REG_SIZE + OP_INDEX_SIZE)) return false;
+                {
+                    reg_t x = FETCH_reg(c, pc);
+                    reg_t y = FETCH_reg(c, pc);
+                    reg_t z = FETCH_reg(c, pc);
+                    index_t i = FETCH_idx(c, pc);
+                    reg(x);
+                    reg(y);
+                    reg(z);
+                    // the thunk of a primitive is [rt rti k exc f a0 a1]
+                    if (op == OP_PRIM) {
+                        ok = ok && (i < PRIM_NONE) && (y + 6 == z);
+                    }
+                }
+                break;
+            case OP_FAIL:
+                if (!fits(pc, OP_LABEL_SIZE)) return false;
+                {
+                    label_t l = FETCH_lbl(c, pc);
+                    labels.push_back(l);
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    if (!ok || (op != OP_RETURN && op != OP_LOOP)) return false;
+
+    for (auto l : labels) {
+        if (!starts.contains(l)) return false;
+    }
+    return true;
+}
+
+// dispatch on the address of the next handler where the compiler supports
+// it, otherwise fall back to a switch
+#if defined(__GNUC__)
+#define EGEL_COMPUTED_GOTO
+#endif
+
+#ifdef EGEL_COMPUTED_GOTO
+#define BYTECODE_CASE(op) L_##op:
+#define BYTECODE_NEXT goto *dispatch[w[pc]]
+#else
+#define BYTECODE_CASE(op) case op:
+#define BYTECODE_NEXT continue
+#endif
+
 // forward declaration
 inline void write_assembly(std::ostream &os, const VMObjectBytecode &o);
 
+// the number of reductions after which lazily compiled bytecode is hot
+#ifndef EGEL_JIT_THRESHOLD
+#define EGEL_JIT_THRESHOLD 1000
+#endif
+
+// the number of self calls a reduction loops over before it returns to the
+// trampoline, which checks whether the reducer is halted
+#ifndef EGEL_LOOP_LIMIT
+#define EGEL_LOOP_LIMIT 1024
+#endif
+
 class VMObjectBytecode : public VMObjectCombinator {
 public:
     VMObjectBytecode(VM *m, const Code &c, const Data &d, const symbol_t s)
-        : VMObjectCombinator(VM_SUB_BYTECODE, m, s), _code(c), _data(d) {};
+        : VMObjectCombinator(VM_SUB_BYTECODE, m, s),
+          _code(c),
+          _data(d),
+          _constants(std::make_shared<Constants>(m, d)),
+          _decoded(decode(c)) {};
 
     VMObjectBytecode(VM *m, const Code &c, const Data &d,
                      const icu::UnicodeString &n)
-        : VMObjectCombinator(VM_SUB_BYTECODE, m, n), _code(c), _data(d) {};
+        : VMObjectCombinator(VM_SUB_BYTECODE, m, n),
+          _code(c),
+          _data(d),
+          _constants(std::make_shared<Constants>(m, d)),
+          _decoded(decode(c)) {};
 
     VMObjectBytecode(VM *m, const Code &c, const Data &d,
                      const icu::UnicodeString &n0, const icu::UnicodeString &n1)
-        : VMObjectCombinator(VM_SUB_BYTECODE, m, n0, n1), _code(c), _data(d) {};
+        : VMObjectCombinator(VM_SUB_BYTECODE, m, n0, n1),
+          _code(c),
+          _data(d),
+          _constants(std::make_shared<Constants>(m, d)),
+          _decoded(decode(c)) {};
 
     VMObjectBytecode(VM *m, const Code &c, const Data &d,
                      const UnicodeStrings &nn, const icu::UnicodeString &n)
-        : VMObjectCombinator(VM_SUB_BYTECODE, m, nn, n), _code(c), _data(d) {};
+        : VMObjectCombinator(VM_SUB_BYTECODE, m, nn, n),
+          _code(c),
+          _data(d),
+          _constants(std::make_shared<Constants>(m, d)),
+          _decoded(decode(c)) {};
+
+    // share the constants of a combinator with its compiled version
+    VMObjectBytecode(VM *m, const Code &c, const Data &d, const symbol_t s,
+                     const ConstantsPtr &k)
+        : VMObjectCombinator(VM_SUB_BYTECODE, m, s),
+          _code(c),
+          _data(d),
+          _constants(k),
+          _decoded(decode(c)) {};
 
     VMObjectBytecode(const VMObjectBytecode &d)
-        : VMObjectBytecode(d.machine(), d.code(), d.data(), d.symbol()) {
+        : VMObjectBytecode(d.machine(), d.code(), d.data(), d.symbol(),
+                           d.constants()) {
     }
 
     static VMObjectPtr create(VM *m, const Code &c, const Data &d,
                               const UnicodeStrings &nn,
                               const icu::UnicodeString &n) {
-        return std::make_shared<VMObjectBytecode>(m, c, d, nn, n);
+        return make_vm_ptr<VMObjectBytecode>(m, c, d, nn, n);
     }
 
     static VMObjectPtr create(VM *m, const Code &c, const Data &d,
                               const icu::UnicodeString &s) {
-        return std::make_shared<VMObjectBytecode>(m, c, d, s);
+        return make_vm_ptr<VMObjectBytecode>(m, c, d, s);
     }
 
-    static std::shared_ptr<VMObjectBytecode> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectBytecode>(o);
+    static vm_ptr<VMObjectBytecode> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectBytecode>(o);
     }
 
     void debug(std::ostream &os) const override {
@@ -396,6 +854,15 @@ public:
         return _data[n];
     }
 
+    ConstantsPtr constants() const {
+        return _constants;
+    }
+
+    // compile to native code after n reductions, never if zero
+    void set_countdown(const uint32_t n) {
+        _countdown.store(n, std::memory_order_relaxed);
+    }
+
     VMObjectPtrs get_data_list() const {
         VMObjectPtrs oo;
         for (unsigned int n = 0; n < _data.size(); n++) {
@@ -404,232 +871,322 @@ public:
         return oo;
     }
 
+#ifdef EGEL_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+    // count a reduction towards compilation
+    void tick(const VMObjectPtr &thunk) const {
+        // of concurrent reducers only the one which takes the count from
+        // one to zero compiles, a lost exchange just skips a tick
+        auto n = _countdown.load(std::memory_order_relaxed);
+        if ((n > 0) && _countdown.compare_exchange_weak(
+                           n, n - 1, std::memory_order_relaxed) &&
+            (n == 1)) {
+            machine()->compile(VMObjectArray::slots(thunk)[4]);
+        }
+    }
+
+    // whether x is a thunk of this very combinator, code which was
+    // redefined meanwhile doesn't match
+    bool self(const VMObjectPtr &x) const {
+        return VMObjectArray::test(x) && (VMObjectArray::slots(x).size() > 4) &&
+               (VMObjectArray::slots(x)[4].get() == this);
+    }
+
+    // whether x is a thunk which continues with the self call t
+    static bool computes(const VMObjectPtr &x, const VMObject *t) {
+        return (x != nullptr) && VMObjectArray::test(x) &&
+               (VMObjectArray::slots(x).size() > 4) &&
+               (VMObjectArray::slots(x)[2].get() == t);
+    }
+
+    // r0 := x when x is a thunk of this combinator. when x computes an
+    // argument of one, as in foldl F (F Z X) XX, it is reduced here as the
+    // trampoline would while the thunks it gives continue with that call,
+    // up to the loop limit. kept out of line since it bloats the dispatch
+    // loop
+    [[gnu::noinline]] bool restart(Registers &reg, VMObjectPtr &x,
+                                   int &loops) const {
+        if (!self(x)) {
+            if (_reducing || !VMObjectArray::test(x) ||
+                (VMObjectArray::slots(x).size() <= 4) ||
+                !self(VMObjectArray::slots(x)[2])) {
+                return false;
+            }
+            // what the clause held is dead, a reduction here may loop too
+            // but doesn't reduce on this stack in turn
+            auto k = std::move(x);
+            auto t = VMObjectArray::slots(k)[2].get();
+            reg.clear();
+            _reducing = true;
+            do {
+                auto f = VMObjectArray::slots(k)[4];
+                k = f->reduce(k);
+            } while (computes(k, t) && (--loops > 0));
+            _reducing = false;
+            x = std::move(k);
+            if (!self(x)) {
+                return false;
+            }
+        }
+        tick(x);
+        reg[0] = std::move(x);
+        return true;
+    }
+
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        std::cerr << "WARNING: unjitted combinator" << std::endl;
-        Registers reg;
+        tick(thunk);
+
+        auto w = _decoded.words.data();
+        auto &k = *_constants;
+        Registers reg(_decoded.registers);
         uint32_t pc = 0;
-        reg.set(0, thunk);
+        reg[0] = thunk;
         bool flag = false;
+        int loops = EGEL_LOOP_LIMIT;
 
         EqualVMObjectPtr equals;
 
-        while (true) {
-            switch (LOOK_op(_code, pc)) {
-                case OP_NIL: {
-                    //  x           x := null
-                    reg_t x = FETCH_reg(_code, pc);
-
-                    reg.set(x, nullptr);
-                } break;
-                case OP_MOV: {
-                    //  x y         x := y
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-
-                    reg.set(x, reg[y]);
-                } break;
-                case OP_DATA: {
-                    //  x i32       x := data(i32)
-                    reg_t x = FETCH_reg(_code, pc);
-                    int32_t i32 = FETCH_i32(_code, pc);
-
-                    reg.set(x, machine()->get_data(_data[i32]));
-                } break;
-                case OP_SET: {
-                    //  x y z       x[val(y)] := z
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-                    reg_t z = FETCH_reg(_code, pc);
-
-                    auto x0 = reg[x];
-                    auto y0 = reg[y];
-                    auto z0 = reg[z];
-
-                    ASSERT(machine()->is_array(x0));
-                    ASSERT(y0->tag() == VM_OBJECT_INTEGER);
-
-                    auto xv = VMObjectArray::cast(x0);
-                    auto yv = machine()->get_integer(y0);
-
-                    xv->set(yv, z0);
-                } break;
-                case OP_TAKEX: {
-                    //  x y z i     x,..,y = z[i],..,z[i+y-x], flag fail
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-                    reg_t z = FETCH_reg(_code, pc);
-                    index_t i = FETCH_idx(_code, pc);
-
-                    auto z0 = reg[z];
-                    if (machine()->is_array(z0)) {
-                        auto zz = VMObjectArray::cast(z0);
-                        flag =
-                            (((int)y - (int)x + 1) <= (int)zz->size() - (int)i);
-                        if (flag) {
-                            for (reg_t n = x; n <= y; n++) {
-                                reg.set(n, zz->get(n - x + i));
-                            }
-                        } else {
-                            // XXX: insert prefetch code here once
+#ifdef EGEL_COMPUTED_GOTO
+        static void *const dispatch[] = {
+            &&L_OP_NIL,   &&L_OP_MOV,     &&L_OP_DATA, &&L_OP_SET,
+            &&L_OP_TAKEX, &&L_OP_SPLIT,   &&L_OP_ARRAY, &&L_OP_CONCATX,
+            &&L_OP_TEST,  &&L_OP_TAG,     &&L_OP_FAIL, &&L_OP_RETURN,
+            &&L_OP_PRIM,  &&L_OP_LOOP,
+        };
+        BYTECODE_NEXT;
+#else
+        while (true) switch (w[pc]) {
+#endif
+            BYTECODE_CASE(OP_NIL) {
+                //  x           x := null
+                reg[w[pc + 1]] = nullptr;
+                pc += 2;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_MOV) {
+                //  x y         x := y
+                reg[w[pc + 1]] = reg[w[pc + 2]];
+                pc += 3;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_DATA) {
+                //  x d         x := data(d)
+                reg[w[pc + 1]] = k[w[pc + 2]];
+                pc += 3;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_SET) {
+                //  x y z       x[val(y)] := z
+                auto &x0 = reg[w[pc + 1]];
+                auto &y0 = reg[w[pc + 2]];
+
+                ASSERT(VMObjectArray::test(x0));
+                ASSERT(y0->tag() == VM_OBJECT_INTEGER);
+
+                auto xv = static_cast<VMObjectArray *>(x0.get());
+                (*xv)[VMObjectInteger::value(y0)] = reg[w[pc + 3]];
+                pc += 4;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_TAKEX) {
+                //  x y z i     x,..,y = z[i],..,z[i+y-x], flag fail
+                reg_t x = w[pc + 1];
+                reg_t y = w[pc + 2];
+                auto z0 = reg[w[pc + 3]];
+                uint32_t i = w[pc + 4];
+
+                if (VMObjectArray::test(z0)) {
+                    auto &zz = VMObjectArray::slots(z0);
+                    flag = (((int)y - (int)x + 1) <= (int)zz.size() - (int)i);
+                    if (flag) {
+                        for (reg_t n = x; n <= y; n++) {
+                            reg[n] = zz[n - x + i];
                         }
-                    } else {
-                        flag = false;
                     }
-                } break;
-                case OP_SPLIT: {
-                    //  x y z       x,..,y = z[0],..,z[y-x], flag not exact
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-                    reg_t z = FETCH_reg(_code, pc);
-
-                    auto z0 = reg[z];
-                    if (machine()->is_array(z0)) {
-                        auto zz = VMObjectArray::cast(z0);
-                        flag = (((int)y - (int)x + 1) == (int)zz->size());
-                        if (flag) {
-                            for (reg_t n = x; n <= y; n++) {
-                                reg.set(n, zz->get(n - x));
-                            }
-                        } else {
-                            // XXX: insert prefetch code here once
+                } else {
+                    flag = false;
+                }
+                pc += 5;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_SPLIT) {
+                //  x y z       x,..,y = z[0],..,z[y-x], flag not exact
+                reg_t x = w[pc + 1];
+                reg_t y = w[pc + 2];
+                auto z0 = reg[w[pc + 3]];
+
+                if (VMObjectArray::test(z0)) {
+                    auto &zz = VMObjectArray::slots(z0);
+                    flag = (((int)y - (int)x + 1) == (int)zz.size());
+                    if (flag) {
+                        for (reg_t n = x; n <= y; n++) {
+                            reg[n] = zz[n - x];
                         }
-                    } else {
-                        flag = false;
                     }
-                } break;
-                case OP_ARRAY: {
-                    //  x y z       x := [ y, y+1,.., z ]
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-                    reg_t z = FETCH_reg(_code, pc);
-
+                } else {
+                    flag = false;
+                }
+                pc += 4;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_ARRAY) {
+                //  x y z       x := [ y, y+1,.., z ]
+                reg_t y = w[pc + 2];
+                reg_t z = w[pc + 3];
+
+                // we do generate empty arrays sometimes
+                size_t sz = (z >= y) ? (size_t)z - y + 1 : 0;
+                auto oo = VMObjectArray::make(sz, sz);
+                for (size_t n = 0; n < sz; n++) {
+                    (*oo)[n] = reg[y + n];
+                }
+                reg[w[pc + 1]] = std::move(oo);
+                pc += 4;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_PRIM) {
+                //  x y z i     x := [ y,.., z ], or reduce primitive i
+                reg_t y = w[pc + 2];
+                reg_t z = w[pc + 3];
+
+                auto r = prim_apply(machine(), w[pc + 4], reg[z - 1], reg[z]);
+                if (r != nullptr) {
+                    auto n = VMObjectInteger::value(reg[y + 1]);
+                    VMObjectArray::cast(reg[y])->set(n, r);
+                    reg[w[pc + 1]] = reg[y + 2];
+                } else {
                     size_t sz = (size_t)z - y + 1;
-                    if (sz > 0) {  // we do generate empty arrays sometimes
-                        auto oo =
-                            VMObjectArray::cast(VMObjectArray::create(sz));
-                        for (reg_t n = y; n <= z; n++) {
-                            oo->set(n - y, reg[n]);
-                        }
-                        reg.set(x, oo);
-                    } else {
-                        auto oo = VMObjectArray::cast(VMObjectArray::create(0));
-                        reg.set(x, oo);
+                    auto oo = VMObjectArray::make(sz, sz);
+                    for (size_t n = 0; n < sz; n++) {
+                        (*oo)[n] = reg[y + n];
                     }
-                } break;
-                case OP_CONCATX: {
-                    //  x y z i     x := y ++ drop i z
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-                    reg_t z = FETCH_reg(_code, pc);
-                    index_t i = FETCH_idx(_code, pc);
-
-                    auto y0 = reg[y];
-                    auto z0 = reg[z];
-                    if ((machine()->is_array(y0)) &&
-                        (machine()->is_array(z0))) {
-                        auto yc = VMObjectArray::cast(y0);
-                        auto zc = VMObjectArray::cast(z0);
-
-                        size_t sz = yc->size() + zc->size() - i;
-
-                        if (i < zc->size()) {  // there are members in z to be
-                                               // copied
-
-                            if (sz > 1) {
-                                auto oo = VMObjectArray::cast(
-                                    VMObjectArray::create(sz));
-                                size_t l = 0;
-                                for (size_t n = 0; n < yc->size(); n++) {
-                                    oo->set(l, yc->get(n));
-                                    l++;
-                                }
-                                for (size_t n = i; n < zc->size(); n++) {
-                                    oo->set(l, zc->get(n));
-                                    l++;
-                                }
-                                reg.set(x, oo);
-                            } else {
-                                auto o = zc->get(i);
-                                reg.set(x, o);
+                    reg[w[pc + 1]] = std::move(oo);
+                }
+                pc += 5;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_CONCATX) {
+                //  x y z i     x := y ++ drop i z
+                auto &x0 = reg[w[pc + 1]];
+                auto y0 = reg[w[pc + 2]];
+                auto z0 = reg[w[pc + 3]];
+                size_t i = w[pc + 4];
+
+                if (VMObjectArray::test(y0) && VMObjectArray::test(z0)) {
+                    auto &yc = VMObjectArray::slots(y0);
+                    auto &zc = VMObjectArray::slots(z0);
+
+                    size_t sz = yc.size() + zc.size() - i;
+
+                    if (i < zc.size()) {  // there are members in z to be
+                                          // copied
+                        if (sz > 1) {
+                            auto oo = VMObjectArray::make(sz, sz);
+                            size_t l = 0;
+                            for (size_t n = 0; n < yc.size(); n++) {
+                                (*oo)[l++] = yc[n];
                             }
-                        } else {  // optimize for `drop i z = {}` case
-                            if (yc->size() == 1) {  // XXX: move to reg.set?
-                                reg.set(x, yc->get(0));
-                            } else {
-                                reg.set(x, y0);
+                            for (size_t n = i; n < zc.size(); n++) {
+                                (*oo)[l++] = zc[n];
                             }
+                            x0 = std::move(oo);
+                        } else {
+                            x0 = zc[i];
                         }
-                    } else if (machine()->is_array(z0)) {
-                        auto zc = VMObjectArray::cast(z0);
-                        size_t sz = 1 + zc->size() - i;
-
-                        if (i < zc->size()) {  // there are members in z to be
-                                               // copied
-                            if (sz > 1) {
-                                auto oo = VMObjectArray::cast(
-                                    VMObjectArray::create(sz));
-                                size_t l = 0;
-                                oo->set(l, y0);
-                                l++;
-                                for (size_t n = i; n < zc->size(); n++) {
-                                    oo->set(l, zc->get(n));
-                                    l++;
-                                }
-                                reg.set(x, oo);
-                            } else {
-                                auto o = zc->get(i);
-                                reg.set(x, o);
+                    } else {  // optimize for `drop i z = {}` case
+                        if (yc.size() == 1) {
+                            x0 = yc[0];
+                        } else {
+                            x0 = y0;
+                        }
+                    }
+                } else if (VMObjectArray::test(z0)) {
+                    auto &zc = VMObjectArray::slots(z0);
+                    size_t sz = 1 + zc.size() - i;
+
+                    if (i < zc.size()) {  // there are members in z to be
+                                          // copied
+                        if (sz > 1) {
+                            auto oo = VMObjectArray::make(sz, sz);
+                            size_t l = 0;
+                            (*oo)[l++] = y0;
+                            for (size_t n = i; n < zc.size(); n++) {
+                                (*oo)[l++] = zc[n];
                             }
-                        } else {  // optimize for `drop i z = {}` case
-                            reg.set(x, y0);
+                            x0 = std::move(oo);
+                        } else {
+                            x0 = zc[i];
                         }
-                    } else {
-                        PANIC("two arrays expected");
-                        return nullptr;
+                    } else {  // optimize for `drop i z = {}` case
+                        x0 = y0;
                     }
-                } break;
-                case OP_TEST: {
-                    //  x y         flag := (x == y)
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-
-                    auto x0 = reg[x];
-                    auto y0 = reg[y];
-                    flag = equals(x0, y0);
-                } break;
-                case OP_TAG: {
-                    //  x y         flag := (x, or x[0], == y)
-                    reg_t x = FETCH_reg(_code, pc);
-                    reg_t y = FETCH_reg(_code, pc);
-
-                    auto x0 = reg[x];
-                    auto y0 = reg[y];
-
-                    auto s0 = x0->symbol();
-                    auto s1 = y0->symbol();
-
-                    flag = (s0 == s1);
-                } break;
-                case OP_FAIL: {
-                    //  l           pc := l, if ~flag
-                    label_t l = FETCH_lbl(_code, pc);
-
-                    if (!flag) pc = l;
-                    flag = false;
-                } break;
-                case OP_RETURN: {
-                    //  x           return x
-                    reg_t x = FETCH_reg(_code, pc);
-
-                    return reg[x];
-                } break;
+                } else {
+                    PANIC("two arrays expected");
+                    return nullptr;
+                }
+                pc += 5;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_TEST) {
+                //  x y         flag := (x == y)
+                flag = equals(reg[w[pc + 1]], reg[w[pc + 2]]);
+                pc += 3;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_TAG) {
+                //  x y         flag := (x, or x[0], == y)
+                auto &x0 = reg[w[pc + 1]];
+                auto &y0 = reg[w[pc + 2]];
+
+                flag = (x0->symbol() == y0->symbol());
+                pc += 3;
             }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_FAIL) {
+                //  l           pc := l, if ~flag
+                pc = flag ? pc + 2 : w[pc + 1];
+                flag = false;
+            }
+            BYTECODE_NEXT;
+            BYTECODE_CASE(OP_RETURN) {
+                //  x           return x
+                return std::move(reg[w[pc + 1]]);
+            }
+            BYTECODE_CASE(OP_LOOP) {
+                //  x           r0, pc := x, 0 on a self call, or return x
+                auto x = w[pc + 1];
+                if ((--loops == 0) || !restart(reg, reg[x], loops)) {
+                    return std::move(reg[x]);
+                }
+                pc = 0;
+            }
+            BYTECODE_NEXT;
+#ifndef EGEL_COMPUTED_GOTO
+            default:
+                PANIC("bytecode case");
+                return nullptr;
         }
+#endif
+    }
+#ifdef EGEL_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+    // the number of registers the combinator uses
+    uint32_t registers() const {
+        return _decoded.registers;
     }
 
 private:
     Code _code;
     Data _data;
+    ConstantsPtr _constants;
+    Decoded _decoded;
+    mutable std::atomic<uint32_t> _countdown = 0;
+
+    static inline thread_local bool _reducing = false;
 };
 
 struct opcode_text_t {
@@ -649,6 +1206,8 @@ constexpr auto STRING_OP_TEST = "test";
 constexpr auto STRING_OP_TAG = "tag";
 constexpr auto STRING_OP_FAIL = "fail";
 constexpr auto STRING_OP_RETURN = "return";
+constexpr auto STRING_OP_PRIM = "prim";
+constexpr auto STRING_OP_LOOP = "loop";
 
 class Disassembler {
 public:
@@ -714,9 +1273,17 @@ public:
                 OP_RETURN,
                 STRING_OP_RETURN,
             },
+            {
+                OP_PRIM,
+                STRING_OP_PRIM,
+            },
+            {
+                OP_LOOP,
+                STRING_OP_LOOP,
+            },
         };
 
-        for (int n = 0; n <= OP_RETURN; n++) {
+        for (int n = 0; n <= OP_LOOP; n++) {
             if (opcode_text_table[n].op == op) {
                 return opcode_text_table[n].text;
             }
@@ -867,6 +1434,7 @@ public:
                     break;
                 case OP_TAKEX:
                 case OP_CONCATX:
+                case OP_PRIM:
                     write_op(os, fetch_op());
                     write_space(os);
                     write_register(os, fetch_register());
@@ -891,6 +1459,7 @@ public:
                     write_label(os, fetch_label());
                     break;
                 case OP_RETURN:
+                case OP_LOOP:
                     write_op(os, fetch_op());
                     write_space(os);
                     write_register(os, fetch_register());
@@ -1186,6 +1755,13 @@ public:
                 auto r2 = fetch_register();
                 auto i0 = fetch_i16();
                 coder.emit_op_concatx(r0, r1, r2, i0);
+            } else if (is_string(STRING_OP_PRIM)) {
+                skip();
+                auto r0 = fetch_register();
+                auto r1 = fetch_register();
+                auto r2 = fetch_register();
+                auto i0 = fetch_i16();
+                coder.emit_op_prim(r0, r1, r2, i0);
             } else if (is_string(STRING_OP_TEST)) {
                 skip();
                 auto r0 = fetch_register();
@@ -1204,6 +1780,10 @@ public:
                 skip();
                 auto r0 = fetch_register();
                 coder.emit_op_return(r0);
+            } else if (is_string(STRING_OP_LOOP)) {
+                skip();
+                auto r0 = fetch_register();
+                coder.emit_op_loop(r0);
             } else {
                 throw ErrorSyntactical(p, "instruction expected");
             }
@@ -1283,4 +1863,16 @@ inline VMObjectPtr assemble(VM *vm, const icu::UnicodeString &s) {
     return a.assemble();
 };
 
+// without GNU lightning there is no native code, bytecode is only interpreted
+#ifndef EGEL_LIGHTNING
+inline VMObjectPtr try_compile(VM *m, const VMObjectPtr &o) {
+    return o;
+};
+
+inline std::vector<VMObjectPtr> emit_jit(VM *m, std::vector<VMObjectPtr> oo,
+                                         const jit_mode_t j) {
+    return oo;
+};
+#endif
+
 }  // namespace egel
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "runtime.hpp"
+
+// a compiled module is cached as text: its docstring, imports,
+// declarations, and values, followed by the combinators it exports, data
+// by name and bytecode as hex with its constants one per line. an entry is
+// named after a hash of the module path and source, and holds the key of
+// the module and everything it imports, transitively, at the time it was
+// compiled.
+
+namespace egel {
+
+// bump on changes to the bytecode or this layout
+#define EGEL_CACHE_FORMAT "egel cache 02"
+
+using cache_key_t = uint64_t;
+
+// fnv-1a over the utf-16 code units
+inline cache_key_t cache_hash(const icu::UnicodeString &s,
+                              cache_key_t h = 0xcbf29ce484222325ULL) {
+    for (int32_t i = 0; i < s.length(); i++) {
+        h ^= s.charAt(i);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+inline cache_key_t cache_hash(const cache_key_t k, cache_key_t h) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (k >> (8 * i)) & 0xff;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+inline icu::UnicodeString cache_key_text(const cache_key_t k) {
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << k;
+    return VM::unicode_from_string(ss.str());
+}
+
+struct CacheImport {
+    int32_t row;
+    int32_t column;
+    icu::UnicodeString name;
+};
+
+struct CacheObject {
+    bool bytecode = false;
+    icu::UnicodeString name;
+    icu::UnicodeString docstring;
+    Code code;
+    std::vector<std::string> data;  // a kind, i f z c t o, and a value
+};
+
+struct CacheEntry {
+    cache_key_t key = 0;
+    icu::UnicodeString docstring;
+    std::vector<CacheImport> imports;
+    UnicodeStrings declarations;
+    UnicodeStrings values;
+    std::vector<std::pair<icu::UnicodeString, icu::UnicodeString>>
+        results;  // serialized values, only in images
+    std::vector<CacheObject> objects;
+};
+
+using CacheEntryPtr = std::shared_ptr<CacheEntry>;
+
+inline icu::UnicodeString cache_path(const icu::UnicodeString &dir,
+                                     const cache_key_t k) {
+    return VM::path_combine(dir, cache_key_text(k) + ".egc");
+}
+
+inline std::string cache_quote(const icu::UnicodeString &s) {
+    std::string q = "\"";
+    q += VM::unicode_to_string(VM::unicode_escape(s));
+    q += "\"";
+    return q;
+}
+
+// the rest of a line after a prefix of n characters
+inline icu::UnicodeString cache_rest(const std::string &l, size_t n) {
+    return VM::unicode_from_string(l.substr(std::min(n, l.size())));
+}
+
+// a data or bytecode combinator as it is cached
+inline CacheObject cache_object(VM *vm, const VMObjectPtr &o) {
+    CacheObject c;
+    c.name = vm->get_combinator_string(o->symbol());
+    if (!vm->is_bytecode(o)) return c;
+
+    auto b = VMObjectBytecode::cast(o);
+    c.bytecode = true;
+    c.docstring = b->docstring();
+    c.code = b->code();
+    for (auto d : b->data()) {
+        auto k = vm->get_data(d);
+        std::string l;
+        switch (k->tag()) {
+            case VM_OBJECT_INTEGER:
+                l = "i " + std::to_string(VMObjectInteger::value(k));
+                break;
+            case VM_OBJECT_FLOAT:
+                l = "f " + fmt::format("{:#}", VMObjectFloat::value(k));
+                break;
+            case VM_OBJECT_COMPLEX: {
+                auto z = VMObjectComplex::value(k);
+                l = "z " + fmt::format("{:#} {:#}", z.real(), z.imag());
+                break;
+            }
+            case VM_OBJECT_CHAR:
+            case VM_OBJECT_TEXT:
+                l = (k->tag() == VM_OBJECT_CHAR) ? "c " : "t ";
+                l += VM::unicode_to_string(k->to_text());
+                break;
+            default:
+                l = "o ";
+                l += VM::unicode_to_string(
+                    vm->get_combinator_string(k->symbol()));
+        }
+        c.data.push_back(l);
+    }
+    return c;
+}
+
+// recreate a cached combinator, constants are entered like the coder does
+inline VMObjectPtr cache_create(VM *vm, const CacheObject &c) {
+    if (!c.bytecode) return vm->create_data(c.name);
+
+    Data dd;
+    for (auto &l : c.data) {
+        auto v = l.substr(2);
+        VMObjectPtr o;
+        switch (l[0]) {
+            case 'i':
+                o = vm->create_integer(std::stoll(v));
+                break;
+            case 'f':
+                o = vm->create_float(std::strtod(v.c_str(), nullptr));
+                break;
+            case 'z': {
+                char *e;
+                auto re = std::strtod(v.c_str(), &e);
+                auto im = std::strtod(e, nullptr);
+                o = vm->create_complex(vm_complex_t(re, im));
+                break;
+            }
+            case 'c':
+                o = vm->create_char(
+                    VM::unicode_to_char(VM::unicode_from_string(v)));
+                break;
+            case 't':
+                o = vm->create_text(
+                    VM::unicode_to_text(VM::unicode_from_string(v)));
+                break;
+            default:
+                o = vm->get_combinator(VM::unicode_from_string(v));
+        }
+        dd.push_back(vm->enter_data(o));
+    }
+    auto b = VMObjectBytecode::create(vm, c.code, dd, c.name);
+    VMObjectBytecode::cast(b)->set_docstring(c.docstring);
+    return b;
+}
+
+// read an entry up to its end, nullptr if it is damaged
+inline CacheEntryPtr cache_read_entry(std::istream &f) {
+    auto e = std::make_shared<CacheEntry>();
+    std::string l;
+    try {
+        while (std::getline(f, l)) {
+            std::istringstream ss(l);
+            std::string tag;
+            ss >> tag;
+            if (tag == "key") {
+                ss >> std::hex >> e->key;
+            } else if (tag == "doc") {
+                e->docstring = VM::unicode_to_text(cache_rest(l, 4));
+            } else if (tag == "import") {
+                CacheImport i;
+                ss >> i.row >> i.column;
+                ss.get();
+                std::string n;
+                std::getline(ss, n);
+                i.name = VM::unicode_to_text(VM::unicode_from_string(n));
+                e->imports.push_back(i);
+            } else if (tag == "declare") {
+                e->declarations.push_back(cache_rest(l, 8));
+            } else if (tag == "value") {
+                e->values.push_back(cache_rest(l, 6));
+            } else if (tag == "result") {
+                std::string n;
+                ss >> n;
+                auto r = cache_rest(l, 8 + n.size());
+                e->results.push_back(
+                    {VM::unicode_from_string(n), VM::unicode_to_text(r)});
+            } else if (tag == "data") {
+                CacheObject o;
+                o.name = cache_rest(l, 5);
+                e->objects.push_back(o);
+            } else if (tag == "bytecode") {
+                CacheObject o;
+                o.bytecode = true;
+                o.name = cache_rest(l, 9);
+                while (std::getline(f, l) && (l != "end")) {
+                    if (l.starts_with("doc ")) {
+                        o.docstring = VM::unicode_to_text(cache_rest(l, 4));
+                    } else if (l.starts_with("code ")) {
+                        for (size_t i = 5; i + 1 < l.size(); i += 2) {
+                            o.code.push_back(
+                                std::stoi(l.substr(i, 2), nullptr, 16));
+                        }
+                    } else if ((l.size() > 2) && (l[1] == ' ') &&
+                               std::strchr("ifzcto", l[0])) {
+                        if (l[0] == 'i') std::stoll(l.substr(2));
+                        o.data.push_back(l);
+                    } else {
+                        return nullptr;
+                    }
+                }
+                if (l != "end") return nullptr;
+                e->objects.push_back(o);
+            } else if (tag == "end") {
+                return e;
+            } else {
+                return nullptr;
+            }
+            if (ss.fail()) return nullptr;
+        }
+    } catch (std::exception &ex) {
+        return nullptr;
+    }
+    return nullptr;  // truncated
+}
+
+inline void cache_write_entry(std::ostream &f, const CacheEntry &e) {
+    f << "key " << VM::unicode_to_string(cache_key_text(e.key)) << "\n";
+    f << "doc " << cache_quote(e.docstring) << "\n";
+    for (auto &i : e.imports) {
+        f << "import " << i.row << " " << i.column << " "
+          << cache_quote(i.name) << "\n";
+    }
+    for (auto &d : e.declarations) {
+        f << "declare " << VM::unicode_to_string(d) << "\n";
+    }
+    for (auto &v : e.values) {
+        f << "value " << VM::unicode_to_string(v) << "\n";
+    }
+    for (auto &[n, r] : e.results) {
+        f << "result " << VM::unicode_to_string(n) << " " << cache_quote(r)
+          << "\n";
+    }
+    for (auto &o : e.objects) {
+        auto n = VM::unicode_to_string(o.name);
+        if (!o.bytecode) {
+            f << "data " << n << "\n";
+            continue;
+        }
+        f << "bytecode " << n << "\n";
+        f << "doc " << cache_quote(o.docstring) << "\n";
+        f << "code " << std::hex << std::setfill('0');
+        for (auto b : o.code) {
+            f << std::setw(2) << (int)b;
+        }
+        f << std::dec << "\n";
+        for (auto &d : o.data) {
+            f << d << "\n";
+        }
+        f << "end\n";
+    }
+    f << "end\n";
+}
+
+// write a file next to where it belongs and move it in place, such that
+// concurrent readers never see half of it
+inline bool cache_write_file(const icu::UnicodeString &fn,
+                             const std::function<void(std::ostream &)> &w) {
+    auto p = fs::path(VM::unicode_to_string(fn));
+    std::error_code ec;
+    if (p.has_parent_path()) {
+        fs::create_directories(p.parent_path(), ec);
+        if (ec) return false;
+    }
+
+    auto tmp = p;
+    tmp += ".";
+    tmp += std::to_string(std::random_device{}());
+    {
+        std::ofstream f(tmp);
+        if (!f) return false;
+        w(f);
+        if (!f) {
+            f.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, p, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// read an entry, nullptr if there is none or it is damaged
+inline CacheEntryPtr cache_read(const icu::UnicodeString &fn) {
+    std::ifstream f(VM::unicode_to_string(fn));
+    if (!f) return nullptr;
+
+    std::string l;
+    if (!std::getline(f, l) || (l != EGEL_CACHE_FORMAT)) return nullptr;
+    return cache_read_entry(f);
+}
+
+// failures are ignored, the cache is an optimization
+inline void cache_write(const icu::UnicodeString &fn, const CacheEntry &e) {
+    cache_write_file(fn, [&e](std::ostream &f) {
+        f << EGEL_CACHE_FORMAT << "\n";
+        cache_write_entry(f, e);
+    });
+}
+
+// an image is the list of loaded modules in the order they were processed.
+// source modules are held as entries with the results of their values,
+// other modules are loaded anew from their path
+#define EGEL_IMAGE_FORMAT "egel image 02"  // bump with EGEL_CACHE_FORMAT
+
+struct ImageModule {
+    icu::UnicodeString path;
+    icu::UnicodeString filename;
+    CacheEntryPtr entry;  // nullptr for modules loaded anew
+};
+
+using ImageModules = std::vector<ImageModule>;
+
+// read an image, false if it is damaged
+inline bool image_read(const icu::UnicodeString &fn, ImageModules &mm) {
+    std::ifstream f(VM::unicode_to_string(fn));
+    if (!f) return false;
+
+    std::string l;
+    if (!std::getline(f, l) || (l != EGEL_IMAGE_FORMAT)) return false;
+    while (std::getline(f, l)) {
+        std::istringstream ss(l);
+        std::string tag, p, n;
+        ss >> tag >> std::quoted(p) >> std::quoted(n);
+        if (ss.fail()) return false;
+        ImageModule m;
+        m.path = VM::unicode_from_string(p);
+        m.filename = VM::unicode_from_string(n);
+        if (tag == "source") {
+            m.entry = cache_read_entry(f);
+            if (m.entry == nullptr) return false;
+        } else if (tag != "module") {
+            return false;
+        }
+        mm.push_back(m);
+    }
+    return true;
+}
+
+inline bool image_write(const icu::UnicodeString &fn, const ImageModules &mm) {
+    return cache_write_file(fn, [&mm](std::ostream &f) {
+        f << EGEL_IMAGE_FORMAT << "\n";
+        for (auto &m : mm) {
+            f << ((m.entry == nullptr) ? "module " : "source ")
+              << std::quoted(VM::unicode_to_string(m.path)) << " "
+              << std::quoted(VM::unicode_to_string(m.filename)) << "\n";
+            if (m.entry != nullptr) cache_write_entry(f, *m.entry);
+        }
+    });
+}
+
+}  // namespace egel
@@ -140,6 +140,8 @@ inline constexpr auto STRING_WITH = "with";
 
 inline constexpr auto STRING_FAIL = "fail";
 
+inline constexpr auto STRING_PROCESS = "process";
+
 // System
 
 inline constexpr auto STRING_SYSTEM = "System";
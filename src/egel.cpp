@@ -44,6 +44,7 @@ enum arg_t {
     OPTION_DIR,
     OPTION_NUMBER,
     OPTION_TEXT,
+    OPTION_MODE,
 };
 
 struct option_t {
@@ -90,6 +91,48 @@ static option_t options[] = {
         OPTION_NONE,
         "blank slate mode",
     },
+    {
+        "-t",
+        "--threads",
+        OPTION_NUMBER,
+        "number of async task workers (default one per core)",
+    },
+    {
+        "-j",
+        "--jit",
+        OPTION_MODE,
+        "compile to native code: eager (default), lazy when hot, or off",
+    },
+    {
+        "-N",
+        "--no-jit",
+        OPTION_NONE,
+        "interpret bytecode, same as --jit=off",
+    },
+    {
+        "-c",
+        "--cache",
+        OPTION_DIR,
+        "cache compiled modules in dir, off by default, never evicted",
+    },
+    {
+        "-R",
+        "--no-cache",
+        OPTION_NONE,
+        "recompile all modules, don't read or write a cache",
+    },
+    {
+        "-S",
+        "--save-image",
+        OPTION_FILE,
+        "load the program and save it to an image, don't run it",
+    },
+    {
+        "-i",
+        "--image",
+        OPTION_FILE,
+        "restore a saved image before loading the program",
+    },
     {
         "-T",
         "--tokens",
@@ -136,6 +179,15 @@ StringPairs parse_options(int argc, char *argv[]) {
     for (int a = 1; a < argc; a++) {
         size_t pp_size = pp.size();
         for (auto &o : options) {
+            // long options also take their argument as --option=argument
+            auto n = strlen(o.longname);
+            if ((o.argument != OPTION_NONE) &&
+                (strncmp(argv[a], o.longname, n) == 0) && (argv[a][n] == '=')) {
+                pp.push_back(
+                    std::make_pair(icu::UnicodeString(o.shortname),
+                                   icu::UnicodeString(argv[a] + n + 1)));
+                continue;
+            }
             if ((strncmp(argv[a], o.shortname, 32) == 0) ||
                 (strncmp(argv[a], o.longname, 32) == 0)) {
                 switch (o.argument) {
@@ -166,6 +218,7 @@ StringPairs parse_options(int argc, char *argv[]) {
                         a++;
                         break;
                     case OPTION_TEXT:
+                    case OPTION_MODE:
                         if (a == argc - 1) goto options_error;
                         pp.push_back(
                             std::make_pair(icu::UnicodeString(o.shortname),
@@ -211,6 +264,9 @@ void display_usage() {
             case OPTION_TEXT:
                 std::cout << "<text>";
                 break;
+            case OPTION_MODE:
+                std::cout << "<mode>";
+                break;
         };
         std::cout << "\t" << o.description << std::endl;
     };
@@ -294,6 +350,38 @@ int main(int argc, char *argv[]) {
         if (p.first == ("-B")) {
             oo->set_bytecode(true);
         };
+        if (p.first == ("-j")) {
+            if (p.second == "eager") {
+                oo->set_jit(JIT_EAGER);
+            } else if (p.second == "lazy") {
+                oo->set_jit(JIT_LAZY);
+            } else if (p.second == "off") {
+                oo->set_jit(JIT_OFF);
+            } else {
+                std::cerr << "options error, try -h." << std::endl;
+                return (EXIT_FAILURE);
+            }
+        };
+        if (p.first == ("-N")) {
+            oo->set_jit(JIT_OFF);
+        };
+    };
+
+    // the module cache, only where asked for since nothing evicts entries
+    for (auto &p : pp) {
+        if (p.first == ("-c")) {
+            oo->set_cache(p.second);
+        };
+        if (p.first == ("-R")) {
+            oo->set_cache("");
+        };
+    };
+
+    // size the async task pool
+    for (auto &p : pp) {
+        if (p.first == ("-t")) {
+            TaskPool::set_workers(VM::unicode_to_int(p.second));
+        };
     };
 
     // check for unique --/fn
@@ -309,6 +397,18 @@ int main(int argc, char *argv[]) {
         }
     };
 
+    // check for images
+    icu::UnicodeString image;
+    icu::UnicodeString save_image;
+    for (auto &p : pp) {
+        if (p.first == ("-i")) {
+            image = p.second;
+        };
+        if (p.first == ("-S")) {
+            save_image = p.second;
+        };
+    };
+
     // check for command
     bool command = false;
     icu::UnicodeString e;
@@ -336,14 +436,17 @@ int main(int argc, char *argv[]) {
     application_version =
         icu::UnicodeString("egel ") + EXECUTABLE_VERSION + " " + EXECUTABLE_OS;
 
-    // load the file
-    if (fn != "") {
-        try {
-            m->eval_module(fn);
-        } catch (Error &e) {
-            std::cerr << e << std::endl;
-            return (EXIT_FAILURE);
+    // restore the image and load the file
+    try {
+        if (image != "") m->eval_image(image);
+        if (fn != "") m->eval_module(fn);
+        if (save_image != "") {
+            m->save_image(save_image);
+            return EXIT_SUCCESS;
         }
+    } catch (Error &e) {
+        std::cerr << e << std::endl;
+        return (EXIT_FAILURE);
     }
 
     // start either interactive or batch mode
@@ -357,7 +460,7 @@ int main(int argc, char *argv[]) {
             std::cerr << e << std::endl;
             return (EXIT_FAILURE);
         }
-    } else if ((fn == "") || oo->interactive()) {
+    } else if (((fn == "") && (image == "")) || oo->interactive()) {
         if (!blank_state) m->eval_command(icu::UnicodeString(populate));
         m->eval_interactive();
     } else {
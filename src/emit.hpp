@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -216,15 +218,69 @@ public:
               in all cases.
     */
 
+    /*
+        Patterns compile to tests which either fall through or jump to a
+        fail label. The clauses of a block are matched as a backtracking
+        automaton: when a test fails, the tests a later clause shares with
+        the failing clause are known to pass or fail without rerunning them.
+        Control thus skips the clauses which would fail on the same test and
+        resumes the first other clause after their common prefix.
+    */
+
+    struct Test {
+        opcode_t op;    // OP_TAKEX, OP_SPLIT, OP_TEST, or OP_TAG
+        reg_t x, y, z;  // as the opcode
+        data_t d;       // the constant tested against, if any
+        VMObjectPtr o;
+
+        bool operator==(const Test &t) const {
+            return (op == t.op) && (x == t.x) && (y == t.y) && (z == t.z) &&
+                   (d == t.d);
+        }
+    };
+
+    struct Clause {
+        std::vector<Test> tests;
+        std::map<icu::UnicodeString, reg_t> variables;
+        reg_t top;  // the first register free after the tests
+        int arity;
+        ptr<Ast> body;
+    };
+
+    void emit_test(const Test &t, label_t l) {
+        switch (t.op) {
+            case OP_TAKEX:
+                get_coder()->emit_op_takex(t.x, t.y, t.z, 5);
+                break;
+            case OP_SPLIT:
+                get_coder()->emit_op_split(t.x, t.y, t.z);
+                break;
+            case OP_TEST: {
+                auto d = get_coder()->emit_data(t.o);
+                get_coder()->emit_op_data(t.y, d);
+                get_coder()->emit_op_test(t.x, t.y);
+            } break;
+            case OP_TAG: {
+                auto d = get_coder()->emit_data(t.o);
+                get_coder()->emit_op_data(t.y, d);
+                get_coder()->emit_op_tag(t.x, t.y);
+            } break;
+            default:
+                PANIC("test expected");
+        }
+        get_coder()->emit_op_fail(l);
+    }
+
+    void add_test(opcode_t op, reg_t x, reg_t y, reg_t z,
+                  const VMObjectPtr &o = nullptr) {
+        data_t d = (o == nullptr) ? 0 : machine()->enter_data(o);
+        _tests.push_back(Test{op, x, y, z, d, o});
+    }
+
     void visit_pattern_constant(const VMObjectPtr &o) {
         auto r = get_pattern_register();
-        auto l = get_fail_label();
         auto ri = get_coder()->generate_register();
-
-        auto d = get_coder()->emit_data(o);
-        get_coder()->emit_op_data(ri, d);
-        get_coder()->emit_op_test(r, ri);
-        get_coder()->emit_op_fail(l);
+        add_test(OP_TEST, r, ri, 0, o);
     }
 
     void visit_pattern(const ptr<Ast> &e) {
@@ -273,20 +329,16 @@ public:
             case AST_EXPR_TAG: {
                 auto [p, v, t] = AstExprTag::split(e);
                 auto r = get_pattern_register();
-                auto l = get_fail_label();
 
                 visit_pattern(v);
 
                 if (t->tag() == AST_EXPR_COMBINATOR) {
                     auto [p, nn, n] = AstExprCombinator::split(t);
                     auto o = machine()->get_combinator(nn, n);
-                    auto d = get_coder()->emit_data(o);
 
                     auto rt = get_coder()->generate_register();
 
-                    get_coder()->emit_op_data(rt, d);
-                    get_coder()->emit_op_tag(r, rt);
-                    get_coder()->emit_op_fail(l);
+                    add_test(OP_TAG, r, rt, 0, o);
                 } else {
                     PANIC("combinator in tag expected");
                 }
@@ -299,7 +351,6 @@ public:
             case AST_EXPR_APPLICATION: {
                 auto [p, ee] = AstExprApplication::split(e);
                 auto r = get_pattern_register();
-                auto l = get_fail_label();
 
                 reg_t x = 0, y = 0;
                 for (size_t n = 0; n < ee.size(); n++) {
@@ -307,8 +358,7 @@ public:
                     if (n == 0) x = y;
                 }
 
-                get_coder()->emit_op_split(x, y, r);
-                get_coder()->emit_op_fail(l);
+                add_test(OP_SPLIT, x, y, r);
 
                 reg_t n = x;
                 for (auto &e : ee) {
@@ -465,9 +515,39 @@ public:
         return t;
     }
 
+    // constants and pattern variables are values when a redex is built
+    bool is_value(const ptr<Ast> &e) {
+        switch (e->tag()) {
+            case AST_EXPR_INTEGER:
+            case AST_EXPR_FLOAT:
+                return true;
+            case AST_EXPR_VARIABLE: {
+                auto [p, v] = AstExprVariable::split(e);
+                return has_variable_binding(v);
+            }
+            default:
+                return false;
+        }
+    }
+
+    // the primitive of a builtin applied to two values, see OP_PRIM
+    prim_t visit_prim(const ptrs<Ast> &ee) {
+        if ((ee.size() != 3) || (ee[0]->tag() != AST_EXPR_COMBINATOR) ||
+            !is_value(ee[1]) || !is_value(ee[2])) {
+            return PRIM_NONE;
+        }
+        auto [p, nn, n] = AstExprCombinator::split(ee[0]);
+        auto o = machine()->get_combinator(nn, n);
+        if (o->subtag() != VM_SUB_BUILTIN) {
+            return PRIM_NONE;
+        }
+        return prim_from_text(o->to_text());
+    }
+
     // a redex is either a combinator, a variable, or an application
-    // sets reg_k, the continuation
-    reg_t visit_redex(const ptr<Ast> &e) {
+    // sets reg_k, the continuation, a redex which isn't the root may
+    // reduce in place
+    reg_t visit_redex(const ptr<Ast> &e, const bool root = true) {
         switch (e->tag()) {
             case AST_EXPR_COMBINATOR: {
                 auto [p, nn, n] = AstExprCombinator::split(e);
@@ -532,7 +612,12 @@ public:
                     }
                 }
 
-                get_coder()->emit_op_array(t, rt, last);
+                auto prim = root ? PRIM_NONE : visit_prim(ee);
+                if (prim == PRIM_NONE) {
+                    get_coder()->emit_op_array(t, rt, last);
+                } else {
+                    get_coder()->emit_op_prim(t, rt, last, prim);
+                }
                 set_register_k(t);
                 return t;
             } break;
@@ -616,7 +701,7 @@ public:
                     get_coder()->emit_op_data(rti, d);
                     set_register_rt(rt);
                     set_register_rti(rti);
-                    visit_redex(e1);
+                    visit_redex(e1, false);
                 } else {
                     PANIC("variable in let expected");
                 }
@@ -627,18 +712,34 @@ public:
         }
     }
 
-    // this is where the visitor is discarded for recursive descent
-    void visit_expr_match(const Position &p, const ptrs<Ast> &mm,
-                          const ptr<Ast> &g, const ptr<Ast> &e) override {
-        // reset the registers for each match
-        auto member = get_coder()->peek_register();
+    // the root is a call to the combinator being defined, after the lets
+    // which reduce its arguments
+    bool is_self_call(const ptr<Ast> &e) {
+        switch (e->tag()) {
+            case AST_EXPR_LET: {
+                auto [p, ee0, e1, e2] = AstExprLet::split(e);
+                return is_self_call(e2);
+            }
+            case AST_EXPR_APPLICATION: {
+                auto [p, ee] = AstExprApplication::split(e);
+                if (ee[0]->tag() != AST_EXPR_COMBINATOR) return false;
+                auto [p0, nn, n] = AstExprCombinator::split(ee[0]);
+                return machine()->enter_symbol(nn, n) == _self;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // the tests on the arguments and patterns of a match
+    Clause visit_clause(const ptr<Ast> &m) {
+        auto [p, mm, g, e] = AstExprMatch::split(m);
         auto r = get_register_frame();
 
-        auto l = get_coder()->generate_label();
-        set_fail_label(l);
+        _tests.clear();
+        reset_variables();
 
         int arity = mm.size();
-        set_arity(arity);
         reg_t x = 0, y = 0;
         for (int n = 0; n < arity; n++) {
             y = get_coder()->generate_register();
@@ -646,8 +747,7 @@ public:
         }
 
         if (arity > 0) {
-            get_coder()->emit_op_takex(x, y, r, 5);
-            get_coder()->emit_op_fail(l);
+            add_test(OP_TAKEX, x, y, r);
         }
 
         reg_t n = x;
@@ -657,30 +757,127 @@ public:
             visit_pattern(m);
         }
 
-        visit_root(e);
-
-        // all matches end with a return
-        auto k = get_register_k();
-        get_coder()->emit_op_return(k);
+        return Clause{_tests, _variables, get_coder()->peek_register(), arity,
+                      e};
+    }
 
-        // generate a label at the end of the match
-        get_coder()->emit_label(l);
-        get_coder()->restore_register(member);
+    // the number of tests two clauses have in common
+    static size_t common_prefix(const Clause &c0, const Clause &c1) {
+        size_t n = 0;
+        while ((n < c0.tests.size()) && (n < c1.tests.size()) &&
+               (c0.tests[n] == c1.tests[n])) {
+            n++;
+        }
+        return n;
     }
 
-    void visit_expr_block(const Position &p, const ptrs<Ast> &alts) override {
-        // keep link registers invariant
+    // this is where the visitor is discarded for recursive descent
+    void visit_matches(const ptrs<Ast> &mm) {
+        // keep link registers invariant, reset the registers for each match
         auto rt = get_register_rt();
         auto rti = get_register_rti();
         auto k = get_register_k();
         auto exc = get_register_exc();
+        auto member = get_coder()->peek_register();
+
+        std::vector<Clause> cc;
+        for (auto &m : mm) {
+            get_coder()->restore_register(member);
+            cc.push_back(visit_clause(m));
+        }
+
+        // the entry points into clauses after a number of passed tests
+        std::map<std::pair<size_t, size_t>, label_t> entries;
+        auto entry = [&](size_t i, size_t n) {
+            auto key = std::make_pair(i, n);
+            if (entries.count(key) == 0) {
+                entries[key] = get_coder()->generate_label();
+            }
+            return entries[key];
+        };
+        auto fail = get_coder()->generate_label();
+
+        entry(0, 0);
+        for (size_t i = 0; i < cc.size(); i++) {
+            auto &c = cc[i];
+
+            // a clause is entered after the tests it shares with another
+            auto first = entries.lower_bound(std::make_pair(i, 0));
+            if ((first == entries.end()) || (first->first.first != i)) {
+                continue;  // unreachable
+            }
+
+            for (size_t n = first->first.second; n < c.tests.size(); n++) {
+                if (entries.count(std::make_pair(i, n)) > 0) {
+                    get_coder()->emit_label(entry(i, n));
+                }
+                // on failure, skip the clauses which fail on the same test
+                auto l = fail;
+                for (size_t j = i + 1; j < cc.size(); j++) {
+                    auto q = common_prefix(c, cc[j]);
+                    if (q <= n) {
+                        l = entry(j, q);
+                        break;
+                    }
+                }
+                emit_test(c.tests[n], l);
+            }
+            if (entries.count(std::make_pair(i, c.tests.size())) > 0) {
+                get_coder()->emit_label(entry(i, c.tests.size()));
+            }
 
-        for (auto &a : alts) {
             set_register_rt(rt);
             set_register_rti(rti);
             set_register_k(k);
             set_register_exc(exc);
-            visit(a);
+            set_arity(c.arity);
+            _variables = c.variables;
+            get_coder()->restore_register(c.top);
+
+            visit_root(c.body);
+
+            // all matches end with a return, a redex root rebinds k
+            if (is_self_call(c.body)) {
+                get_coder()->emit_op_loop(get_register_k());
+            } else {
+                get_coder()->emit_op_return(get_register_k());
+            }
+        }
+
+        // generate a label at the end of the matches
+        get_coder()->emit_label(fail);
+        get_coder()->restore_register(member);
+        set_register_rt(rt);
+        set_register_rti(rti);
+        set_register_k(k);
+        set_register_exc(exc);
+    }
+
+    void visit_expr_match(const Position &p, const ptrs<Ast> &mm,
+                          const ptr<Ast> &g, const ptr<Ast> &e) override {
+        visit_matches({AstExprMatch::create(p, mm, g, e)});
+    }
+
+    void visit_expr_block(const Position &p, const ptrs<Ast> &alts) override {
+        bool matches = std::all_of(alts.begin(), alts.end(), [](auto &a) {
+            return a->tag() == AST_EXPR_MATCH;
+        });
+        if (matches) {
+            visit_matches(alts);
+        } else {
+            // keep link registers invariant
+            auto rt = get_register_rt();
+            auto rti = get_register_rti();
+            auto k = get_register_k();
+            auto exc = get_register_exc();
+
+            for (auto &a : alts) {
+                set_register_rt(rt);
+                set_register_rti(rti);
+                set_register_k(k);
+                set_register_exc(exc);
+                visit(a);
+            }
         }
     }
 
@@ -714,6 +911,9 @@ public:
         set_register_exc(exc);
         set_arity(0);
 
+        auto [p0, ss, s] = AstExprCombinator::split(n);
+        _self = machine()->enter_symbol(ss, s);
+
         get_coder()->emit_op_takex(rt, c, frame, 0);
         get_coder()->emit_op_fail(l);
         visit(e);
@@ -731,7 +931,6 @@ public:
         auto code = get_coder()->code();
         auto data = get_coder()->data();
 
-        auto [p0, ss, s] = AstExprCombinator::split(n);
         auto b = VMObjectBytecode::create(machine(), code, data, ss, s);
 
         auto [p1, doc] = AstDocstring::split(d);
@@ -768,10 +967,12 @@ private:
     reg_t _register_exc;
 
     int _arity;
+    symbol_t _self;  // the combinator being defined
     reg_t _pattern_reg;
     label_t _fail;
     std::map<icu::UnicodeString, reg_t> _variables;
     std::map<icu::UnicodeString, std::tuple<reg_t, int>> _redexes;
+    std::vector<Test> _tests;
     std::unique_ptr<Coder> _coder;
     std::tuple<reg_t, int> _cursor;
 
@@ -50,10 +50,8 @@ public:
     }
 
     void declare(const icu::UnicodeString &k, const icu::UnicodeString &v) {
-        if (_map.count(k) > 0) {
+        if (!_map.emplace(k, v).second) {
             throw ErrorSemantical("redeclaration of " + k);
-        } else {
-            _map[k] = v;
         }
     }
 
@@ -63,8 +61,9 @@ public:
     }
 
     icu::UnicodeString get(const icu::UnicodeString &k) const {
-        if (_map.count(k) > 0) {
-            return _map.at(k);
+        auto i = _map.find(k);
+        if (i != _map.end()) {
+            return i->second;
         } else if (_outer != nullptr) {
             return _outer->get(k);
         } else {
@@ -72,6 +71,17 @@ public:
         }
     }
 
+    // the keys starting with a prefix are adjacent in the map
+    std::vector<icu::UnicodeString> prefixed(
+        const icu::UnicodeString &p) const {
+        std::vector<icu::UnicodeString> dd;
+        for (auto i = _map.lower_bound(p);
+             (i != _map.end()) && i->first.startsWith(p); ++i) {
+            dd.push_back(i->first);
+        }
+        return dd;
+    }
+
     void render(std::ostream &os, int indent) const {
         os << "scope (" << std::endl;
         os << "namespace: " << _namespace << std::endl;
@@ -159,14 +169,7 @@ inline void declare_rename(ScopePtr scope, const icu::UnicodeString& k, const ic
 }
 
 inline std::vector<icu::UnicodeString> get_namespace(ScopePtr scope, const icu::UnicodeString& ns) {
-    auto map = get_global_scope(scope)->map();
-    std::vector<icu::UnicodeString> dd;
-    for (const auto &kv:map) {
-        if (kv.first.startsWith(ns)) {
-            dd.push_back(kv.first);
-        }
-    }
-    return dd;
+    return get_global_scope(scope)->prefixed(ns + "::");
 }
 
 inline ScopePtr enter_namespace(ScopePtr scope, const icu::UnicodeString& s) {
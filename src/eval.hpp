@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <thread>
 
 #include "machine.hpp"
 #include "modules.hpp"
@@ -18,7 +20,7 @@ public:
     }
 
     static VMObjectPtr create(VM *m, const symbol_t s, const callback_t call) {
-        return std::make_shared<EvalResult>(m, s, call);
+        return make_vm_ptr<EvalResult>(m, s, call);
     }
 
     callback_t callback() const {
@@ -49,19 +51,27 @@ inline void default_exception_callback(VM *vm, const VMObjectPtr &e) {
 }
 
 // XXX: get rid of this once. simply shouldn't be necessary
+// the value is owned through an atomic pointer, when the val is redefined
+// the value is released once no reader is between loading and counting it,
+// and stale references reduce to the new definition
 class VarCombinator : public VMObjectCombinator {
 public:
     VarCombinator(VM *m, const symbol_t s, const VMReduceResult &r)
-        : VMObjectCombinator(VM_SUB_BUILTIN, m, s), _result(r) {
+        : VMObjectCombinator(VM_SUB_BUILTIN, m, s),
+          _value(VMObjectPtr(r.result).detach()) {
     }
 
     VarCombinator(const VarCombinator &c)
         : VarCombinator(c.machine(), c.symbol(), c.result()) {
     }
 
+    ~VarCombinator() {
+        VMObjectPtr::attach(_value.load());
+    }
+
     static VMObjectPtr create(VM *m, const symbol_t s,
                               const VMReduceResult &r) {
-        return std::make_shared<VarCombinator>(m, s, r);
+        return make_vm_ptr<VarCombinator>(m, s, r);
     }
 
     static VMObjectPtr create(VM *vm, const VMObjectPtr &o,
@@ -76,7 +86,23 @@ public:
     }
 
     VMReduceResult result() const {
-        return _result;
+        _readers.fetch_add(1);
+        VMObjectPtr v(_value.load());
+        _readers.fetch_sub(1, std::memory_order_release);
+        return VMReduceResult{v};
+    }
+
+    void shared_children(std::vector<const VMObject *> &oo) const override {
+        auto v = _value.load();
+        if (v != nullptr) oo.push_back(v);
+    }
+
+    VMObjectPtr retire() const override {
+        auto v = _value.exchange(nullptr);
+        while (_readers.load() != 0) {
+            std::this_thread::yield();
+        }
+        return VMObjectPtr::attach(v);
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
@@ -87,13 +113,19 @@ public:
         auto exc = tt[3];
         // auto c   = tt[4];
 
+        auto v = result().result;
+        if (v == nullptr) {  // retired, reduce the current definition
+            tt[4] = machine()->get_combinator(symbol());
+            return machine()->create_array(tt);
+        }
+
         // XXX: doesn't handle exceptions yet
         VMObjectPtrs rr;
         rr.push_back(rt);
         rr.push_back(rti);
         rr.push_back(k);
         rr.push_back(exc);
-        rr.push_back(_result.result);
+        rr.push_back(v);
         for (uint i = 5; i < tt.size(); i++) {
             rr.push_back(tt[i]);
         }
@@ -101,7 +133,8 @@ public:
     }
 
 private:
-    VMReduceResult _result;
+    mutable std::atomic<VMObject *> _value;
+    mutable std::atomic<int> _readers = 0;
 };
 
 class Eval;
@@ -174,6 +207,24 @@ public:
         vm->define_data(d);
     }
 
+    // a value as it was evaluated before, restored from an image
+    void define_value(const icu::UnicodeString &val, const VMObjectPtr &o) {
+        auto vm = machine();
+        auto sym = vm->enter_symbol(val);
+        auto d = VarCombinator::create(vm, sym, VMReduceResult{o});
+        vm->define_data(d);
+    }
+
+    void eval_image(const icu::UnicodeString &fn) {
+        auto mm = get_manager();
+        Position p("", 0, 0);
+        mm->load_image(p, fn);
+    }
+
+    void save_image(const icu::UnicodeString &fn) {
+        get_manager()->save_image(fn);
+    }
+
     /*
      * Interactive evaluation.
      *
@@ -271,7 +322,7 @@ public:
         egel::emit_data(vm, w);
         w = egel::lift(w, vm);
         auto oo = egel::emit_code(vm, w);
-        egel::emit_jit(vm, oo);
+        egel::emit_jit(vm, oo, mm->get_options()->jit());
     }
 
     void handle_data(const ptr<Ast> &d) {
@@ -302,7 +353,7 @@ public:
         egel::emit_data(vm, w);
         w = egel::lift(w, vm);
         auto oo = egel::emit_code(vm, w);
-        egel::emit_jit(vm, oo);
+        egel::emit_jit(vm, oo, mm->get_options()->jit());
     }
 
     // XXX XXX XXX: get rid of all of this once. See handle_expression.
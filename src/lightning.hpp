@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+
 #include "bytecode.hpp"
 #include "runtime.hpp"
 
@@ -110,10 +114,11 @@ inline void op_mov(VM* vm, VMObjectPtr* a, int x, int y) {
     a[x] = a[y];
 };
 
-// OP_DATA x i32, x := data(i32)
-inline void op_data(VM* vm, VMObjectPtr* a, int x, int i) {
-    TRACE_JIT(std::cerr << "OP_DATA r" << x << ", i" << i << std::endl);
-    a[x] = vm->get_data(i);
+// OP_DATA x i32, x := data(i32), from the constant at address c
+inline void op_data(VM* vm, VMObjectPtr* a, int x,
+                    const Constants::slot_t* c) {
+    a[x] = VMObjectPtr(c->load(std::memory_order_acquire));
+    TRACE_JIT(std::cerr << "OP_DATA r" << x << ", " << a[x] << std::endl);
 };
 
 // OP_ARRAY x y z, x := [ y, y+1,.., z ]
@@ -122,12 +127,11 @@ inline void op_array(VM* vm, VMObjectPtr* a, int x, int y, int z) {
                         << std::endl);
     //  if (y <= z) {
     auto n = (z - y) + 1;
-    auto a0 = VMObjectArray::create(n);
-    auto a1 = VMObjectArray::cast(a0);
+    auto a0 = VMObjectArray::make(n, n);
     for (int i = 0; i < n; i++) {
-        a1->set(i, a[y + i]);
+        (*a0)[i] = a[y + i];
     }
-    a[x] = a1;
+    a[x] = std::move(a0);
     // }
 };
 
@@ -135,7 +139,7 @@ inline void op_array(VM* vm, VMObjectPtr* a, int x, int y, int z) {
 inline void op_set(VM* vm, VMObjectPtr* a, int x, int y, int z) {
     TRACE_JIT(std::cerr << "OP_MOV r" << x << ", r" << y << ", r" << z
                         << std::endl);
-    int n = VMObjectInteger::cast(a[y])->value();
+    int n = VMObjectInteger::value(a[y]);
     auto a0 = VMObjectArray::cast(a[x]);
     a0->set(n, a[z]);
 };
@@ -146,13 +150,14 @@ inline void op_takex(VM* vm, VMObjectPtr* a, int x, int y, int z, int i,
     TRACE_JIT(std::cerr << "OP_TAKEX r" << x << ", r" << y << ", r" << z
                         << ", i" << i << std::endl);
     int n = (y - x) + 1;
-    auto a0 = VMObjectArray::cast(a[z]);
-    if (((int)a0->size()) < i + n) {
+    auto a0 = a[z];  // held, z may be overwritten
+    auto aa = VMObjectArray::value(a0);
+    if (((int)aa.size()) < i + n) {
         *flag = (void*)false;
     } else {
         *flag = (void*)true;
         for (int j = 0; j < n; j++) {
-            a[x + j] = a0->get(i + j);
+            a[x + j] = aa[i + j];
         }
     }
 };
@@ -162,13 +167,14 @@ inline void op_split(VM* vm, VMObjectPtr* a, int x, int y, int z, void** flag) {
     TRACE_JIT(std::cerr << "OP_SPLIT r" << x << ", r" << y << ", r" << z
                         << std::endl);
     auto n = (y - x) + 1;
-    auto a0 = VMObjectArray::cast(a[z]);
-    if (((int)a0->size()) != n) {
+    auto a0 = a[z];  // held, z may be overwritten
+    auto aa = VMObjectArray::value(a0);
+    if (((int)aa.size()) != n) {
         *flag = (void*)false;
     } else {
         *flag = (void*)true;
         for (int i = 0; i < n; i++) {
-            a[x + i] = a0->get(i);
+            a[x + i] = aa[i];
         }
     }
 };
@@ -238,9 +244,7 @@ inline void op_test(VM* vm, VMObjectPtr* a, int x, int y, void** flag) {
 // OP_TAG x y, flag := (x->tag() == y)
 inline void op_tag(VM* vm, VMObjectPtr* a, int x, int y, void** flag) {
     TRACE_JIT(std::cerr << "OP_TAG r" << x << ", r" << y << std::endl);
-    auto s0 = (a[x])->symbol();  // XXX, wut?
-    auto s1 = (a[y])->symbol();
-    bool b = (s0 == s1);
+    bool b = (a[x]->symbol() == a[y]->symbol());
     *flag = (void*)b;  // cast to word size
 };
 
@@ -253,6 +257,32 @@ inline void op_return(VM*, VMObjectPtr* a, int x, VMObjectPtr* ret) {
 
 };  // extern "C"
 
+// OP_PRIM x y z i16, x := [ y,.., z ], or reduce primitive i, one helper
+// per primitive such that it is applied without dispatch
+template <uint32_t I>
+inline void op_prim(VM* vm, VMObjectPtr* a, int x, int y, int z) {
+    TRACE_JIT(std::cerr << "OP_PRIM r" << x << ", r" << y << ", r" << z
+                        << ", i" << I << std::endl);
+    auto r = prim_apply(vm, std::integral_constant<uint32_t, I>(), a[z - 1],
+                        a[z]);
+    if (r != nullptr) {
+        int n = VMObjectInteger::value(a[y + 1]);
+        VMObjectArray::cast(a[y])->set(n, r);
+        a[x] = a[y + 2];
+    } else {
+        op_array(vm, a, x, y, z);
+    }
+};
+
+template <size_t... I>
+constexpr auto op_prims(std::index_sequence<I...>) {
+    return std::array<void (*)(VM*, VMObjectPtr*, int, int, int),
+                      sizeof...(I)>{&op_prim<I>...};
+}
+
+inline constexpr auto op_prim_table =
+    op_prims(std::make_index_sequence<PRIM_NONE>());
+
 namespace egel {
 
 using namespace egel;
@@ -350,6 +380,9 @@ public:
                             uint16_t i) {
     }
 
+    virtual void op_prim(uint32_t pc, reg_t x, reg_t y, reg_t z, uint16_t i) {
+    }
+
     virtual void op_test(uint32_t pc, reg_t x, reg_t y) {
     }
 
@@ -362,33 +395,33 @@ public:
     virtual void op_return(uint32_t pc, reg_t x) {
     }
 
+    virtual void op_loop(uint32_t pc, reg_t x) {
+    }
+
     void pass() {
         reset();
 
         while (!is_end()) {
+            auto p = pc();
             switch (look()) {
                 case OP_NIL: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     op_nil(p, x);
                 } break;
                 case OP_MOV: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
                     op_mov(p, x, y);
                 } break;
                 case OP_DATA: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto i = fetch_i32();
                     op_data(p, x, i);
                 } break;
                 case OP_SET: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
@@ -396,7 +429,6 @@ public:
                     op_set(p, x, y, z);
                 } break;
                 case OP_SPLIT: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
@@ -404,7 +436,6 @@ public:
                     op_split(p, x, y, z);
                 } break;
                 case OP_ARRAY: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
@@ -412,7 +443,6 @@ public:
                     op_array(p, x, y, z);
                 } break;
                 case OP_TAKEX: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
@@ -421,7 +451,6 @@ public:
                     op_takex(p, x, y, z, i);
                 } break;
                 case OP_CONCATX: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
@@ -429,32 +458,41 @@ public:
                     auto i = fetch_index();
                     op_concatx(p, x, y, z, i);
                 } break;
+                case OP_PRIM: {
+                    fetch_op();
+                    auto x = fetch_register();
+                    auto y = fetch_register();
+                    auto z = fetch_register();
+                    auto i = fetch_index();
+                    op_prim(p, x, y, z, i);
+                } break;
                 case OP_TEST: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
                     op_test(p, x, y);
                 } break;
                 case OP_TAG: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     auto y = fetch_register();
                     op_tag(p, x, y);
                 } break;
                 case OP_FAIL: {
-                    auto p = pc();
                     fetch_op();
                     auto l = fetch_label();
                     op_fail(p, l);
                 } break;
                 case OP_RETURN: {
-                    auto p = pc();
                     fetch_op();
                     auto x = fetch_register();
                     op_return(p, x);
                 } break;
+                case OP_LOOP: {
+                    fetch_op();
+                    auto x = fetch_register();
+                    op_loop(p, x);
+                } break;
             }
         }
     }
@@ -563,6 +601,13 @@ public:
         max(z);
     }
 
+    virtual void op_prim(uint32_t pc, reg_t x, reg_t y, reg_t z,
+                         uint16_t i) override {
+        max(x);
+        max(y);
+        max(z);
+    }
+
     virtual void op_test(uint32_t pc, reg_t x, reg_t y) override {
         max(x);
         max(y);
@@ -581,27 +626,13 @@ public:
         max(x);
     }
 
-private:
-    reg_t _max;
-    std::set<label_t> _labels;
-};
-
-// map locals to globals
-class PushData : public DataPass {
-public:
-    PushData(VM* m, const VMObjectPtr& o) : DataPass(m, o) {
-    }
-
-    data_t get_data(uint32_t entry) {
-        return _map[entry];
-    }
-
-    virtual void data_entry(uint32_t key, uint32_t value) override {
-        _map[key] = value;
+    virtual void op_loop(uint32_t pc, reg_t x) override {
+        max(x);
     }
 
 private:
-    std::map<int, int> _map;
+    reg_t _max;
+    std::set<label_t> _labels;
 };
 
 class EmitNative : public BytecodePass {
@@ -609,7 +640,7 @@ public:
     EmitNative(VM* m, const VMObjectPtr& o)
         : BytecodePass(m, o),
           _proc(nullptr),
-          _data(PushData(m, o)),
+          _constants(VMObjectBytecode::cast(o)->constants()),
           _analyzebytecode(m, o) {
     }
 
@@ -654,14 +685,16 @@ public:
         jit_finishi((void*)::op_mov);
     }
 
+    // constants are loaded by address from the pool, which the machine
+    // patches on redefinition
     virtual void op_data(uint32_t pc, reg_t x, uint32_t d) override {
         emit_label(pc);
+        auto c = _constants->address(d);
         jit_prepare();
-        jit_pushargr(JIT_V0);        // VM*
-        jit_pushargr(JIT_V1);        // registers
-        jit_pushargi((int)x);        // x
-        auto g = _data.get_data(d);  // get the global
-        jit_pushargi((int)g);        // d
+        jit_pushargr(JIT_V0);         // VM*
+        jit_pushargr(JIT_V1);         // registers
+        jit_pushargi((int)x);         // x
+        jit_pushargi((jit_word_t)c);  // constant
         jit_finishi((void*)::op_data);
     }
 
@@ -726,6 +759,19 @@ public:
         jit_finishi((void*)::op_concatx);
     }
 
+    virtual void op_prim(uint32_t pc, reg_t x, reg_t y, reg_t z,
+                         uint16_t i) override {
+        emit_label(pc);
+        jit_prepare();
+        jit_pushargr(JIT_V0);  // VM*
+        jit_pushargr(JIT_V1);  // registers
+        jit_pushargi((int)x);  // x
+        jit_pushargi((int)y);  // y
+        jit_pushargi((int)z);  // z
+        ASSERT(i < PRIM_NONE);
+        jit_finishi((void*)op_prim_table[i]);
+    }
+
     virtual void op_test(uint32_t pc, reg_t x, reg_t y) override {
         emit_label(pc);
         jit_prepare();
@@ -757,6 +803,16 @@ public:
 
     virtual void op_return(uint32_t pc, reg_t x) override {
         emit_label(pc);
+        emit_return(x);
+    }
+
+    // the trampoline reduces a self call like any other continuation
+    virtual void op_loop(uint32_t pc, reg_t x) override {
+        emit_label(pc);
+        emit_return(x);
+    }
+
+    void emit_return(reg_t x) {
         jit_addi(JIT_R0, JIT_FP, _return_offset);
         jit_ldr(JIT_R1, JIT_R0);
         jit_prepare();
@@ -798,13 +854,9 @@ public:
 
     void* emit() {
         _analyzebytecode.pass();
-        _data.pass();
 
-        static bool initialized = false;  // XXX: not thread safe
-        if (!initialized) {
-            initialized = true;
-            init_jit(nullptr);
-        }
+        static std::once_flag initialized;
+        std::call_once(initialized, [] { init_jit(nullptr); });
 
         _jit = jit_new_state();
         jit_prolog();
@@ -888,7 +940,7 @@ private:
     void* _proc;
     jit_state* _jit;
     std::map<int, jit_node_t*> _labels;
-    PushData _data;
+    ConstantsPtr _constants;
     AnalyzeBytecode _analyzebytecode;
 
     int _reg_n = 0;
@@ -902,13 +954,13 @@ private:
 class VMObjectLightning : public VMObjectBytecode {
 public:
     VMObjectLightning(VM* m, const Code& c, const Data& d, const symbol_t s,
-                      void* p)
-        : VMObjectBytecode(m, c, d, s), _proc(p) {
+                      const ConstantsPtr& k, void* p)
+        : VMObjectBytecode(m, c, d, s, k), _proc(p) {
     }
 
     VMObjectLightning(const VMObjectLightning& l)
         : VMObjectLightning(l.machine(), l.code(), l.data(), l.symbol(),
-                            l.proc()) {
+                            l.constants(), l.proc()) {
         set_docstring(l.docstring());
     }
 
@@ -917,8 +969,9 @@ public:
     }
 
     static VMObjectPtr create(VM* m, const Code& c, const Data& d,
-                              const symbol_t s, void* p) {
-        return std::make_shared<VMObjectLightning>(m, c, d, s, p);
+                              const symbol_t s, const ConstantsPtr& k,
+                              void* p) {
+        return make_vm_ptr<VMObjectLightning>(m, c, d, s, k, p);
     }
 
     VMObjectPtr reduce(const VMObjectPtr& thunk) const override {
@@ -946,19 +999,31 @@ private:
     void* _proc;
 };
 
+// emit native code for bytecode, without defining it
+inline VMObjectPtr compile_native(VM* m, const VMObjectPtr& o) {
+    TRACE_JIT(std::cerr << "compiling " << o->to_text() << std::endl);
+
+    // reducers compile hot bytecode concurrently, emission is serialized
+    // since GNU lightning isn't known to be thread safe
+    static std::mutex emitting;
+    std::unique_lock<std::mutex> lock(emitting);
+    auto e = EmitNative(m, o);
+    auto p = e.emit();
+    lock.unlock();
+
+    auto b = VMObjectBytecode::cast(o);
+    auto l = VMObjectLightning::create(m, b->code(), b->data(), b->symbol(),
+                                       b->constants(), p);
+
+    VMObjectLightning::cast(l)->set_docstring(b->docstring());
+    TRACE_JIT(std::cerr << "l->sub(" << l->subtag() << ")" << std::endl);
+    return l;
+}
+
+// compile and define, also called by a reducer which found its bytecode hot
 inline VMObjectPtr try_compile(VM* m, const VMObjectPtr& o) {
     if (m->is_bytecode(o)) {
-        TRACE_JIT(std::cerr << "compiling " << o->to_text() << std::endl);
-
-        auto e = EmitNative(m, o);
-        auto p = e.emit();
-
-        auto b = VMObjectBytecode::cast(o);
-        auto l =
-            VMObjectLightning::create(m, b->code(), b->data(), b->symbol(), p);
-
-        VMObjectLightning::cast(l)->set_docstring(b->docstring());
-        TRACE_JIT(std::cerr << "l->sub(" << l->subtag() << ")" << std::endl);
+        auto l = compile_native(m, o);
         m->overwrite(l);
         return l;
     } else {
@@ -966,13 +1031,43 @@ inline VMObjectPtr try_compile(VM* m, const VMObjectPtr& o) {
     }
 };
 
+// compile all bytecode, then define the results in one batch
 inline std::vector<VMObjectPtr> emit_jit(VM* m, std::vector<VMObjectPtr> oo) {
-    std::vector<VMObjectPtr> oo0;
-    for (auto& o : oo) {
-        auto o0 = try_compile(m, o);
-        oo0.push_back(o0);
+    std::vector<size_t> todo;
+    for (size_t i = 0; i < oo.size(); i++) {
+        if (m->is_bytecode(oo[i])) todo.push_back(i);
     }
+
+    std::vector<VMObjectPtr> oo0 = oo;
+    for (auto n : todo) {
+        oo0[n] = compile_native(m, oo[n]);
+    }
+
+    m->lock();
+    for (auto n : todo) {
+        m->overwrite(oo0[n]);
+    }
+    m->unlock();
     return oo0;
 };
 
+// compile now, or let the bytecode compile itself once it is hot
+inline std::vector<VMObjectPtr> emit_jit(VM* m, std::vector<VMObjectPtr> oo,
+                                         const jit_mode_t j) {
+    switch (j) {
+        case JIT_EAGER:
+            return emit_jit(m, oo);
+        case JIT_LAZY:
+            for (auto& o : oo) {
+                if (m->is_bytecode(o)) {
+                    auto b = VMObjectBytecode::cast(o);
+                    b->set_countdown(EGEL_JIT_THRESHOLD);
+                }
+            }
+            return oo;
+        default:
+            return oo;
+    }
+};
+
 }  // namespace egel
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <map>
@@ -9,6 +10,7 @@
 #include <sstream>
 #include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include "environment.hpp"
@@ -40,42 +42,49 @@ void set_stack_size(size_t size) {
     }
 }
 
+// names are interned in a hash table, the symbol is the index of the name
+struct HashUnicodeString {
+    size_t operator()(const icu::UnicodeString &s) const {
+        return s.hashCode();
+    }
+};
+
 class SymbolTable {
 public:
-    SymbolTable()
-        : _to(std::vector<icu::UnicodeString>()),
-          _from(std::map<icu::UnicodeString, symbol_t>()) {
+    SymbolTable() {
     }
 
     SymbolTable(const SymbolTable &other) : _to(other._to), _from(other._from) {
     }
 
     bool member(const icu::UnicodeString &s) const {
-        return (_from.count(s) > 0);
+        return _from.contains(s);
     }
 
     symbol_t enter(const icu::UnicodeString &s) {
-        if (_from.count(s) == 0) {
+        auto i = _from.find(s);
+        if (i == _from.end()) {
             symbol_t n = _to.size();
             _to.push_back(s);
-            _from[s] = n;
+            _from.emplace(s, n);
             return n;
         } else {
-            return _from[s];
+            return i->second;
         }
     }
 
     symbol_t enter(const icu::UnicodeString &n0, const icu::UnicodeString &n1) {
-        icu::UnicodeString n = n0 + STRING_DCOLON + n1;
+        icu::UnicodeString n(n0.length() + 2 + n1.length(), 0, 0);
+        n.append(n0).append(STRING_DCOLON).append(n1);
         return enter(n);
     }
 
     symbol_t enter(const UnicodeStrings &nn, const icu::UnicodeString &n) {
         icu::UnicodeString s;
         for (auto &n0 : nn) {
-            s += n0 + STRING_DCOLON;
+            s.append(n0).append(STRING_DCOLON);
         }
-        s += n;
+        s.append(n);
         return enter(s);
     }
 
@@ -95,29 +104,33 @@ public:
 
 private:
     std::vector<icu::UnicodeString> _to;
-    std::map<icu::UnicodeString, symbol_t> _from;
+    std::unordered_map<icu::UnicodeString, symbol_t, HashUnicodeString> _from;
 };
 
+// data is hashed consistently with the comparison on objects, combinators
+// hash by their symbol
 class DataTable {
 public:
-    DataTable() : _to(std::vector<VMObjectPtr>()) {
-        // _from(std::map<VMObjectPtr, data_t, LessVMObjectPtr>()) {
+    DataTable() {
     }
 
-    DataTable(const DataTable &other) : _to(other._to), _from(other._from) {
+    DataTable(const DataTable &other)
+        : _to(other._to), _from(other._from), _users(other._users) {
     }
 
     void initialize() {
     }
 
     data_t enter(const VMObjectPtr &s) {
-        if (_from.count(s) == 0) {
+        auto i = _from.find(s);
+        if (i == _from.end()) {
+            s->enshrine();  // the data table is visible to all threads
             data_t n = _to.size();
             _to.push_back(s);
-            _from[s] = n;
+            _from.emplace(s, n);
             return n;
         } else {
-            return _from[s];
+            return i->second;
         }
     }
 
@@ -126,17 +139,21 @@ public:
     }
 
     data_t define(const VMObjectPtr &s) {
-        if (_from.count(s) == 0) {
+        auto i = _from.find(s);
+        if (i == _from.end()) {
             return enter(s);
         } else {
-            data_t n = _from[s];
+            data_t n = i->second;
+            s->enshrine();
+            // what the old entry held is released on return
+            auto old = (_to[n] == s) ? nullptr : _to[n]->retire();
             _to[n] = s;
             return n;
         }
     }
 
     bool has(const VMObjectPtr &s) {
-        return (_from.count(s) > 0);
+        return _from.contains(s);
     }
 
     VMObjectPtr get(const data_t &s) {
@@ -147,6 +164,20 @@ public:
         return _from[o];
     }
 
+    // entry u holds a constant which refers to entry d
+    void depend(const data_t u, const data_t d) {
+        auto &uu = _users[d];
+        if (std::find(uu.begin(), uu.end(), u) == uu.end()) {
+            uu.push_back(u);
+        }
+    }
+
+    const std::vector<data_t> &users(const data_t d) {
+        static const std::vector<data_t> none;
+        auto i = _users.find(d);
+        return (i == _users.end()) ? none : i->second;
+    }
+
     void render(std::ostream &os) {
         for (size_t t = 0; t < _to.size(); t++) {
             os << std::setw(8) << t << ":";
@@ -157,7 +188,9 @@ public:
 
 private:
     std::vector<VMObjectPtr> _to;
-    std::map<VMObjectPtr, data_t, LessVMObjectPtr> _from;
+    std::unordered_map<VMObjectPtr, data_t, HashVMObjectPtr, EqualVMObjectPtr>
+        _from;
+    std::unordered_map<data_t, std::vector<data_t>> _users;
 };
 
 class VMObjectResult : public VMObjectCombinator {
@@ -177,7 +210,7 @@ public:
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         auto arg0 = tt[5];
 
         _result->result = arg0;
@@ -256,6 +289,11 @@ public:
         ASSERT(tuple0 == SYMBOL_TUPLE);
         ASSERT(nil0 == SYMBOL_NIL);
         ASSERT(cons0 == SYMBOL_CONS);
+        // symbols the runtime tests against on hot paths
+        auto object0 = _symbols.enter(STRING_SYSTEM, STRING_OBJECT);
+        auto process0 = _symbols.enter(STRING_SYSTEM, STRING_PROCESS);
+        ASSERT(object0 == SYMBOL_OBJECT);
+        ASSERT(process0 == SYMBOL_PROCESS);
 
         _tuple = VMObjectData::create(this, tuple0);
         _nil = VMObjectData::create(this, nil0);
@@ -283,49 +321,89 @@ public:
         _eval->init(_manager);
     }
 
+    // the symbol and data tables are read and written by any thread, e.g.,
+    // when bytecode is compiled lazily or a module is loaded while others
+    // run. every access takes the one lock, which a caller may already hold
+    // around a batch of them
+
     // symbol table manipulation
     symbol_t enter_symbol(const icu::UnicodeString &n) override {
+        std::lock_guard guard(_mutex);
         return _symbols.enter(n);
     }
 
     symbol_t enter_symbol(const icu::UnicodeString &n0,
                           const icu::UnicodeString &n1) override {
+        std::lock_guard guard(_mutex);
         return _symbols.enter(n0, n1);
     }
 
     symbol_t enter_symbol(const UnicodeStrings &nn,
                           const icu::UnicodeString &n) override {
+        std::lock_guard guard(_mutex);
         return _symbols.enter(nn, n);
     }
 
     virtual int get_combinators_size() override {
+        std::lock_guard guard(_mutex);
         return _symbols.size();
     }
 
     icu::UnicodeString get_combinator_string(symbol_t s) override {
+        std::lock_guard guard(_mutex);
         return _symbols.get(s);
     }
 
     // data table manipulation
     data_t enter_data(const VMObjectPtr &o) override {
-        return _data.enter(o);
+        std::lock_guard guard(_mutex);
+        auto d = _data.enter(o);
+        depend_data(d, o);
+        return d;
     }
 
     data_t define_data(const VMObjectPtr &o) override {
-        return _data.define(o);
+        std::lock_guard guard(_mutex);
+        auto old = _data.has(o) ? _data.get(_data.get(o)) : nullptr;
+        auto d = _data.define(o);
+        depend_data(d, o);
+        // patch the constants which refer to a redefined entry, also those
+        // of the old definition, which may still run and call itself
+        for (auto u : _data.users(d)) {
+            auto b = _data.get(u);
+            if (is_bytecode(b)) {
+                VMObjectBytecode::cast(b)->constants()->patch(d, o);
+            }
+        }
+        if ((old != nullptr) && (old != o) && is_bytecode(old)) {
+            VMObjectBytecode::cast(old)->constants()->patch(d, o);
+        }
+        return d;
+    }
+
+    // record which entries the constants of a bytecode entry refer to
+    void depend_data(const data_t d, const VMObjectPtr &o) {
+        if (is_bytecode(o) && (_data.get(d).get() == o.get())) {
+            for (auto i : VMObjectBytecode::cast(o)->data()) {
+                _data.depend(d, i);
+            }
+        }
     }
 
     data_t get_data(const VMObjectPtr &o) override {
+        std::lock_guard guard(_mutex);
         return _data.get(o);
     }
 
     VMObjectPtr get_data(const data_t d) override {
+        std::lock_guard guard(_mutex);
         return _data.get(d);
     }
 
     // convenience
     bool has_combinator(const symbol_t s) override {
         auto o = VMObjectStub::create(this, s);
+        std::lock_guard guard(_mutex);
         return _data.has(o);
     }
 
@@ -348,8 +426,9 @@ public:
 
     VMObjectPtr get_combinator(const symbol_t s) override {
         auto o = VMObjectStub::create(this, s);
-        auto d = enter_data(o);
-        return get_data(d);
+        std::lock_guard guard(_mutex);
+        auto d = _data.enter(o);
+        return _data.get(d);
     }
 
     VMObjectPtr get_combinator(const icu::UnicodeString &n) override {
@@ -372,6 +451,7 @@ public:
     void define(const VMObjectPtr &o) override {
         // define an undefined symbol
         auto s = o->to_text();  // XXX: usually works? probably not for {}
+        std::lock_guard guard(_mutex);
         if (_symbols.member(s)) {
             throw create_text("redeclaration of " + s);
         } else {
@@ -383,6 +463,7 @@ public:
     void overwrite(const VMObjectPtr &o) override {
         // define or overwrite
         auto s = o->to_text();  // XXX: usually works?
+        std::lock_guard guard(_mutex);
         enter_symbol(s);
         define_data(o);
     }
@@ -395,36 +476,29 @@ public:
     // reduce an expression
     void reduce(const VMObjectPtr &f, const VMObjectPtr &ret,
                 const VMObjectPtr &exc, reducer_state_t *run) override {
-        VMObjectPtrs rr;
-        rr.push_back(nullptr);  // rt
-        rr.push_back(nullptr);  // rti
-        rr.push_back(nullptr);  // k
-        rr.push_back(nullptr);  // exc
-        rr.push_back(ret);      // c
-        rr.push_back(nullptr);  // arg0
-        auto r = create_array(rr);
-
-        VMObjectPtrs ee;
-        ee.push_back(nullptr);  // rt
-        ee.push_back(nullptr);  // rti
-        ee.push_back(nullptr);  // k
-        ee.push_back(nullptr);  // exc
-        ee.push_back(exc);      // c
-        // ee.push_back(nullptr);  // arg0
-        auto e = create_array(ee);
-
-        auto i = VMObjectInteger::create(5);
-        VMObjectPtrs tt;
-        tt.push_back(r);  // rt
-        tt.push_back(i);  // rti
-        tt.push_back(r);  // k
-        tt.push_back(e);  // exc
-        tt.push_back(f);  // c
-        auto t = create_array(tt);
-
-        auto trampoline = t;
-        while ((trampoline != nullptr) && (*run != HALTED)) {
-            if (*run == RUNNING) {
+        // the frames are built in place, slots start out empty
+        auto r = VMObjectArray::cast(VMObjectArray::create(6));
+        r->set(4, ret);  // c
+
+        auto e = VMObjectArray::cast(VMObjectArray::create(5));
+        e->set(4, exc);  // c
+
+        auto t = VMObjectArray::cast(VMObjectArray::create(5));
+        t->set(0, r);                           // rt
+        t->set(1, VMObjectInteger::create(5));  // rti
+        t->set(2, r);                           // k
+        t->set(3, e);                           // exc
+        t->set(4, f);                           // c
+
+        // the state is changed by other threads, a sleeping reducer blocks
+        // until it is woken up with a notify on the state
+        std::atomic_ref<reducer_state_t> state(*run);
+        VMObjectPtr trampoline = std::move(t);
+        while (trampoline != nullptr) {
+            auto st = state.load(std::memory_order_relaxed);
+            if (st == HALTED) {
+                break;
+            } else if (st == RUNNING) {
                 ASSERT(VMObjectArray::test(trampoline));
                 auto f = VMObjectArray::cast(trampoline)->get(4);
 #ifdef DEBUG
@@ -432,9 +506,8 @@ public:
                 std::cout << "on : " << trampoline << std::endl;
 #endif
                 trampoline = f->reduce(trampoline);
-            } else if (*run == SLEEPING) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            } else {  // *run == HALTED
+            } else {  // st == SLEEPING
+                state.wait(SLEEPING);
             }
         }
     }
@@ -454,7 +527,11 @@ public:
         auto se = enter_symbol("Internal", "exception");
         auto e = VMObjectResult::create(this, se, &r, true);
 
+        auto s0 = VMObjectArray::frame_stats();
         reduce(f, m, e, run);
+        auto s1 = VMObjectArray::frame_stats();
+        r.frames.reused = s1.reused - s0.reused;
+        r.frames.allocated = s1.allocated - s0.allocated;
         return r;
     }
 
@@ -472,6 +549,7 @@ public:
     }
 
     void render(std::ostream &os) override {
+        std::lock_guard guard(_mutex);
         os << "SYMBOLS: " << std::endl;
         _symbols.render(os);
         os << "DATA: " << std::endl;
@@ -503,8 +581,16 @@ public:
         return VMObjectChar::create(c);
     }
 
-    VMObjectPtr create_text(const vm_text_t s) override {
-        return VMObjectText::create(s);
+    VMObjectPtr create_text(vm_text_t s) override {
+        return VMObjectText::create(std::move(s));
+    }
+
+    VMObjectPtr create_text_slice(const VMObjectPtr &o, const vm_int_t start,
+                                  const vm_int_t length) override {
+        auto n = VMObjectText::value_ref(o).length();
+        auto i = static_cast<int32_t>(std::clamp<vm_int_t>(start, 0, n));
+        auto l = static_cast<int32_t>(std::clamp<vm_int_t>(length, 0, n - i));
+        return VMObjectText::create_slice(o, i, l);
     }
 
     VMObjectPtr create_float(const vm_float_t f) override {
@@ -516,7 +602,7 @@ public:
     }
 
     bool is_integer(const VMObjectPtr &o) override {
-        return o->tag() == VM_OBJECT_INTEGER;
+        return VMObjectInteger::test(o);
     }
 
     bool is_float(const VMObjectPtr &o) override {
@@ -528,7 +614,7 @@ public:
     }
 
     bool is_char(const VMObjectPtr &o) override {
-        return o->tag() == VM_OBJECT_CHAR;
+        return VMObjectChar::test(o);
     }
 
     bool is_text(const VMObjectPtr &o) override {
@@ -556,20 +642,20 @@ public:
         return VMObjectChar::value(o);
     }
 
-    vm_text_t get_text(const VMObjectPtr &o) override {
-        return VMObjectText::value(o);
+    const vm_text_t &get_text(const VMObjectPtr &o) override {
+        return VMObjectText::value_ref(o);
     }
 
     VMObjectPtr create_none() override {
-        return get_data(SYMBOL_NONE);
+        return _none;
     }
 
     VMObjectPtr create_true() override {
-        return get_data(SYMBOL_TRUE);
+        return _true;
     }
 
     VMObjectPtr create_false() override {
-        return get_data(SYMBOL_FALSE);
+        return _false;
     }
 
     // predefined constants
@@ -622,15 +708,15 @@ public:
     }
 
     bool is_none(const VMObjectPtr &o) override {
-        return (object_none_test(o));
+        return (o == _none) || object_none_test(o);
     }
 
     bool is_true(const VMObjectPtr &o) override {
-        return (object_true_test(o));
+        return (o == _true) || object_true_test(o);
     }
 
     bool is_false(const VMObjectPtr &o) override {
-        return (object_false_test(o));
+        return (o == _false) || object_false_test(o);
     }
 
     bool is_bool(const VMObjectPtr &o) override {
@@ -638,7 +724,7 @@ public:
     }
 
     bool is_nil(const VMObjectPtr &o) override {
-        return (object_nil_test(o));
+        return (o == _nil) || object_nil_test(o);
     }
 
     bool is_cons(const VMObjectPtr &o) override {
@@ -674,7 +760,8 @@ public:
     }
 
     VMObjectPtrs get_array(const VMObjectPtr &o) override {
-        return VMObjectArray::value(o);
+        auto aa = VMObjectArray::value(o);
+        return VMObjectPtrs(aa.begin(), aa.end());
     }
 
     bool is_combinator(const VMObjectPtr &o) override {
@@ -707,6 +794,10 @@ public:
         return b->get_data_list();
     }
 
+    VMObjectPtr compile(const VMObjectPtr &o) override {
+        return egel::try_compile(this, o);
+    }
+
     VMObjectPtr assemble(const icu::UnicodeString &s) override {
         return egel::assemble(this, s);
     }
@@ -719,11 +810,20 @@ public:
         return deserialize_from_string(this, s);
     }
 
+    std::string serialize_binary(const VMObjectPtr &o) override {
+        return serialize_to_binary(this, o);
+    }
+
+    VMObjectPtr deserialize_binary(const std::string &s) override {
+        return deserialize_from_binary(this, s);
+    }
+
     VMObjectPtrs dependencies(const VMObjectPtr &o) override {
         return egel::dependencies(this, o);
     }
 
     icu::UnicodeString symbol(const VMObjectPtr &o) override {
+        std::lock_guard guard(_mutex);
         return _symbols.get(o->symbol());
     }
 
@@ -966,6 +1066,19 @@ public:
         _eval->eval_value(val);
     }
 
+    void define_value(const icu::UnicodeString &val,
+                      const VMObjectPtr &o) override {
+        _eval->define_value(val, o);
+    }
+
+    void eval_image(const icu::UnicodeString &fn) override {
+        _eval->eval_image(fn);
+    }
+
+    void save_image(const icu::UnicodeString &fn) override {
+        _eval->save_image(fn);
+    }
+
     VMObjectPtr position_to_object(const Position &p) {
         auto s = p.resource();
         auto r = p.row();
@@ -1065,10 +1178,12 @@ public:
 
     VMObjectPtr query_symbols() override {
         VMObjectPtrs oo;
+        std::unique_lock guard(_mutex);
         auto sz = _symbols.size();
         for (int i = 0; i < sz; i++) {
             oo.push_back(create_text(_symbols.get(i)));
         }
+        guard.unlock();
         return to_list(oo);
     }
 
@@ -1095,7 +1210,7 @@ private:
     SymbolTable _symbols;
     DataTable _data;
     void *_context;
-    std::mutex _mutex;
+    std::recursive_mutex _mutex;
 
     VMObjectPtr _int;
     VMObjectPtr _float;
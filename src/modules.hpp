@@ -6,7 +6,10 @@
 #include <dlfcn.h>
 #endif
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
 #include "ast.hpp"
@@ -22,6 +25,7 @@
 #include "builtin_runtime.hpp"
 #include "builtin_string.hpp"
 #include "builtin_system.hpp"
+#include "cache.hpp"
 #include "constants.hpp"
 #include "desugar.hpp"
 #include "emit.hpp"
@@ -29,7 +33,9 @@
 #include "error.hpp"
 #include "lexical.hpp"
 #include "lift.hpp"
+#ifdef EGEL_LIGHTNING
 #include "lightning.hpp"
+#endif
 #include "runtime.hpp"
 #include "semantical.hpp"
 #include "syntactical.hpp"
@@ -134,6 +140,26 @@ public:
 
     virtual VMObjectPtrs exports() = 0;
 
+    // a hash of what the module is made of, imports excluded
+    virtual cache_key_t source_key() const {
+        return cache_hash(get_path());
+    }
+
+    // the hash of the module and everything it imports, before processing
+    virtual void set_key(const cache_key_t k) {
+    }
+
+    // the module as it is held in an image, nullptr for modules which are
+    // loaded anew
+    virtual CacheEntryPtr image(VM *vm) {
+        return nullptr;
+    }
+
+    // a value restored from an image, nullptr if it must be evaluated
+    virtual VMObjectPtr result(VM *vm, const icu::UnicodeString &v) {
+        return nullptr;
+    }
+
     virtual void render(std::ostream &os) const = 0;
 
     friend std::ostream &operator<<(std::ostream &os, const ModulePtr &m) {
@@ -169,7 +195,7 @@ private:
 };
 
 class VMModule;
-using VMModulePtr = std::shared_ptr<VMModule>;
+using VMModulePtr = vm_ptr<VMModule>;
 
 class VMModule : public Opaque {
 public:
@@ -192,7 +218,7 @@ public:
     }
 
     static VMObjectPtr create(VM *vm, ModulePtr p) {
-        return std::make_shared<VMModule>(vm, p);
+        return make_vm_ptr<VMModule>(vm, p);
     }
 
     ModulePtr value() const {
@@ -221,7 +247,7 @@ public:
     }
 
     static VMModulePtr module_cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMModule>(o);
+        return vm_ptr_cast<VMModule>(o);
     }
 
     VMObjectPtr name() {
@@ -414,6 +440,13 @@ public:
         dlclose(_handle);
     }
 
+    cache_key_t source_key() const override {
+        std::error_code ec;
+        auto t = fs::last_write_time(VM::unicode_to_string(get_path()), ec);
+        return cache_hash(t.time_since_epoch().count(),
+                          Module::source_key());
+    }
+
     QualifiedStrings imports() override {
         return _imports;
     }
@@ -472,7 +505,10 @@ public:
     ModuleSource(const ModuleSource &m)
         : Module(m.get_path(), m.get_filename(), m.machine()),
           _source(m._source),
-          _ast(m._ast) {
+          _ast(m._ast),
+          _source_key(m._source_key),
+          _key(m._key),
+          _imports(m._imports) {
         set_options(m.get_options());
     }
 
@@ -484,6 +520,7 @@ public:
     void load() override {
         if (VM::file_exists(get_path())) {
             _source = VM::read_utf8_file(get_path());
+            _source_key = cache_hash(_source, Module::source_key());
         } else {
             throw ErrorIO("module " + get_path() + " not found");
         };
@@ -493,20 +530,18 @@ public:
     }
 
     QualifiedStrings imports() override {
-        auto aa = egel::imports(_ast);
-        auto ii = QualifiedStrings();
-        for (auto a : aa) {
-            if (a->tag() == AST_DIRECT_IMPORT) {
-                auto [p, s] = AstDirectImport::split(a);
-                ii.push_back(QualifiedString(p, VM::unicode_to_text(s)));
-            }
-        }
-        return ii;
+        return _imports;
     }
 
     QualifiedStrings values() override {
-        auto aa = egel::values(_ast);
         auto ii = QualifiedStrings();
+        if (_cached != nullptr) {
+            for (auto &v : _cached->values) {
+                ii.push_back(QualifiedString(Position(), v));
+            }
+            return ii;
+        }
+        auto aa = egel::values(_ast);
         for (auto a : aa) {
             if (a->tag() == AST_DECL_VALUE) {
                 auto [p, n, d, f] = AstDeclValue::split(a);
@@ -520,39 +555,90 @@ public:
         return _combinators;
     }
 
-    void syntactical() override {
-        StringCharReader r = StringCharReader(get_filename(), _source);
-        Tokens tt = tokenize_from_reader(r);
-        sanitize(tt);
+    cache_key_t source_key() const override {
+        return _source_key;
+    }
 
-        if (get_options()->only_tokenize()) {
-            while (tt.look().tag() != TOKEN_EOF) {
-                std::cout << tt.look() << " ";
-                tt.skip();
-            };
-            std::cout << std::endl;
-            exit(EXIT_SUCCESS);
-        };
+    // an entry compiled against other imports is dropped, the source is
+    // still there
+    void set_key(const cache_key_t k) override {
+        if ((_cached != nullptr) && (_cached->key != k)) {
+            _cached = nullptr;
+            parse_source();
+        }
+        _key = k;
+    }
 
-        auto a = parse(tt);
+    void syntactical() override {
+        if (_cached != nullptr) return;
+        if (get_options()->use_cache()) {
+            auto fn = cache_path(get_options()->cache(), _source_key);
+            auto c = cache_read(fn);
+            if (c != nullptr) {
+                set_entry(c);
+                return;
+            }
+        }
+        parse_source();
+    }
 
-        if (get_options()->only_unparse()) {
-            std::cout << a << std::endl;
-            exit(EXIT_SUCCESS);
-        };
+    // restore the module from an entry instead of its source
+    void set_entry(const CacheEntryPtr &e) {
+        _cached = e;
+        set_docstring(e->docstring);
+        _imports = QualifiedStrings();
+        for (auto &i : e->imports) {
+            Position p(get_filename(), i.row, i.column);
+            _imports.push_back(QualifiedString(p, i.name));
+        }
+    }
 
-        auto doc = egel::visit_docstring(a);
-        auto [p, d] = AstDocstring::split(doc);
-        set_docstring(VM::unicode_to_text(d));
-        _source = "";
-        _ast = a;
+    CacheEntryPtr image(VM *vm) override {
+        auto e = std::make_shared<CacheEntry>(entry(vm));
+        for (auto &v : e->values) {
+            // values which don't serialize are evaluated again on restore
+            try {
+                auto r = vm->reduce(vm->get_combinator(v));
+                if (!r.exception) {
+                    e->results.push_back({v, vm->serialize(r.result)});
+                }
+            } catch (const VMObjectPtr &) {
+            }
+        }
+        return e;
+    }
+
+    VMObjectPtr result(VM *vm, const icu::UnicodeString &v) override {
+        if (_cached == nullptr) return nullptr;
+        for (auto &[n, r] : _cached->results) {
+            if (n == v) return vm->deserialize(r);
+        }
+        return nullptr;
     }
 
     void declarations(ScopePtr &env) override {
+        if (_cached != nullptr) {
+            _declarations = _cached->declarations;
+            for (auto &d : _cached->declarations) {
+                try {
+                    egel::declare_global(env, d);
+                } catch (ErrorSemantical &e) {
+                    throw ErrorSemantical(Position(get_filename(), 1, 1),
+                                          "redeclaration of " + d);
+                }
+            }
+            return;
+        }
         declare(env, _ast);
+        auto sc = Scope::create();
+        declare(sc, _ast);
+        for (auto &kv : sc->map()) {
+            _declarations.push_back(kv.first);
+        }
     }
 
     void semantical(ScopePtr &env) override {
+        if (_cached != nullptr) return;
         _ast = egel::identify(env, _ast);
 
         if (get_options()->only_semantical()) {
@@ -565,6 +651,7 @@ public:
     }
 
     void desugar() override {
+        if (_cached != nullptr) return;
         _ast = egel::desugar(_ast);
         if (get_options()->only_desugar()) {
             std::cout << _ast << std::endl;
@@ -573,6 +660,7 @@ public:
     }
 
     void lift(VM *m) override {
+        if (_cached != nullptr) return;
         _ast = egel::lift(_ast, m);
 
         if (get_options()->only_lift()) {
@@ -582,6 +670,16 @@ public:
     }
 
     void datagen(VM *vm) override {
+        if (_cached != nullptr) {
+            for (auto &o : _cached->objects) {
+                if (!o.bytecode) {
+                    auto c = cache_create(vm, o);
+                    vm->define_data(c);
+                    _combinators.push_back(c);
+                }
+            }
+            return;
+        }
         auto oo = egel::emit_data(vm, _ast);
         for (auto &o : oo) {
             _combinators.push_back(o);
@@ -589,6 +687,16 @@ public:
     }
 
     void codegen(VM *vm) override {
+        if (_cached != nullptr) {
+            for (auto &o : _cached->objects) {
+                if (o.bytecode) {
+                    auto b = cache_create(vm, o);
+                    vm->define_data(b);
+                    _combinators.push_back(b);
+                }
+            }
+            return;
+        }
         auto oo = egel::emit_code(vm, _ast);
         if (get_options()->only_bytecode()) {
             vm->render(std::cout);
@@ -597,10 +705,15 @@ public:
         for (auto &o : oo) {
             _combinators.push_back(o);
         }
+        if (get_options()->use_cache()) {
+            cache_write(cache_path(get_options()->cache(), _source_key),
+                        entry(vm));
+        }
     }
 
     void jit(VM *vm) override {
-        _combinators = emit_jit(vm, _combinators);
+        _bytecode = _combinators;
+        _combinators = emit_jit(vm, _combinators, get_options()->jit());
     }
 
     void render(std::ostream &os) const override {
@@ -612,9 +725,72 @@ public:
     }
 
 private:
+    void parse_source() {
+        StringCharReader r = StringCharReader(get_filename(), _source);
+        Tokens tt = tokenize_from_reader(r);
+        sanitize(tt);
+
+        if (get_options()->only_tokenize()) {
+            while (tt.look().tag() != TOKEN_EOF) {
+                std::cout << tt.look() << " ";
+                tt.skip();
+            };
+            std::cout << std::endl;
+            exit(EXIT_SUCCESS);
+        };
+
+        auto a = parse(tt);
+
+        if (get_options()->only_unparse()) {
+            std::cout << a << std::endl;
+            exit(EXIT_SUCCESS);
+        };
+
+        auto doc = egel::visit_docstring(a);
+        auto [p, d] = AstDocstring::split(doc);
+        set_docstring(VM::unicode_to_text(d));
+        _source = "";
+        _ast = a;
+
+        _imports = QualifiedStrings();
+        auto aa = egel::imports(_ast);
+        for (auto a : aa) {
+            if (a->tag() == AST_DIRECT_IMPORT) {
+                auto [p, s] = AstDirectImport::split(a);
+                _imports.push_back(QualifiedString(p, VM::unicode_to_text(s)));
+            }
+        }
+    }
+
+    // the module as compiled, before native code replaced its bytecode
+    CacheEntry entry(VM *vm) {
+        auto &oo = _bytecode.empty() ? _combinators : _bytecode;
+        CacheEntry e;
+        e.key = _key;
+        e.docstring = docstring();
+        for (auto &i : _imports) {
+            auto p = i.position();
+            e.imports.push_back(CacheImport{p.row(), p.column(), i.string()});
+        }
+        e.declarations = _declarations;
+        for (auto &v : values()) {
+            e.values.push_back(v.string());
+        }
+        for (auto &o : oo) {
+            e.objects.push_back(cache_object(vm, o));
+        }
+        return e;
+    }
+
     icu::UnicodeString _source;
     ptr<Ast> _ast;
+    cache_key_t _source_key = 0;
+    cache_key_t _key = 0;
+    CacheEntryPtr _cached;
+    QualifiedStrings _imports;
+    UnicodeStrings _declarations;
     std::vector<VMObjectPtr> _combinators;
+    std::vector<VMObjectPtr> _bytecode;
 };
 
 class ModuleEgg : public Module {
@@ -627,7 +803,8 @@ public:
     ModuleEgg(const ModuleEgg &m)
         : Module(m.get_path(), m.get_filename(), m.machine()),
           _source(m._source),
-          _ast(m._ast) {
+          _ast(m._ast),
+          _source_key(m._source_key) {
         set_options(m.get_options());
     }
 
@@ -639,6 +816,7 @@ public:
     void load() override {
         if (VM::file_exists(get_path())) {
             _source = VM::read_utf8_file(get_path());
+            _source_key = cache_hash(_source, Module::source_key());
         } else {
             throw ErrorIO("egg " + get_path() + " not found");
         };
@@ -675,6 +853,10 @@ public:
         return _combinators;
     }
 
+    cache_key_t source_key() const override {
+        return _source_key;
+    }
+
     void syntactical() override {
         StringCharReader r = StringCharReader(get_filename(), _source);
         Tokens tt = tokenize_from_egg_reader(r);
@@ -755,7 +937,7 @@ public:
     }
 
     void jit(VM *vm) override {
-        _combinators = emit_jit(vm, _combinators);
+        _combinators = emit_jit(vm, _combinators, get_options()->jit());
     }
 
     void render(std::ostream &os) const override {
@@ -769,6 +951,7 @@ public:
 private:
     icu::UnicodeString _source;
     ptr<Ast> _ast;
+    cache_key_t _source_key = 0;
     std::vector<VMObjectPtr> _combinators;
 };
 
@@ -852,10 +1035,46 @@ public:
         _loading[0]->set_options(_options);
         transitive_closure();
         reverse();  // XXX: why was this again?
+        keys();
         process();
         flush();
     }
 
+    // restore the modules of an image, source modules from their entries
+    void load_image(const Position &p, const icu::UnicodeString &fn) {
+        ImageModules ii;
+        if (!image_read(fn, ii)) {
+            throw ErrorIO(p, "image \"" + fn + "\" not read");
+        }
+        for (auto &i : ii) {
+            if (already_loaded(i.path)) continue;
+            if (i.entry == nullptr) {
+                preload(p, i.path);
+                _loading.back()->syntactical();
+            } else {
+                auto m = std::make_shared<ModuleSource>(i.path, i.filename,
+                                                        _machine);
+                m->set_options(get_options()->imported());
+                m->set_entry(i.entry);
+                _loading.push_back(m);
+            }
+        }
+        process();
+        flush();
+    }
+
+    void save_image(const icu::UnicodeString &fn) {
+        ImageModules ii;
+        for (auto &m : _modules) {
+            if (m->get_path() == "") continue;  // internal
+            ii.push_back(ImageModule{m->get_path(), m->get_filename(),
+                                     m->image(_machine)});
+        }
+        if (!image_write(fn, ii)) {
+            throw ErrorIO("image \"" + fn + "\" not written");
+        }
+    }
+
     QualifiedStrings values() {
         QualifiedStrings ss;
         for (auto &m : _modules) {
@@ -918,7 +1137,7 @@ protected:
                 } else {
                     throw ErrorIO(p, "file \"" + fn + "\" has wrong extension");
                 }
-                m->set_options(Options::create());  // XXX check this
+                m->set_options(get_options()->imported());
                 try {
                     m->load();
                 } catch (ErrorIO &e) {
@@ -942,6 +1161,48 @@ protected:
         }
     }
 
+    // every module is keyed by its source and the sources of everything it
+    // imports, transitively, such that cached code is only used when
+    // the names it was resolved against didn't change
+    void keys() {
+        std::map<icu::UnicodeString, ModulePtr> paths;
+        for (auto &mm : {_modules, _loading}) {
+            for (auto &m : mm) {
+                paths[m->get_path()] = m;
+            }
+        }
+
+        std::map<ModulePtr, ModulePtrs> imported;
+        for (auto &[p, m] : paths) {
+            for (auto &i : m->imports()) {
+                auto fn = search(get_options()->get_include_path(), i.string());
+                auto j = paths.find(fn);
+                if (j != paths.end()) imported[m].push_back(j->second);
+            }
+        }
+
+        for (auto &m : _loading) {
+            std::set<ModulePtr> seen;
+            std::vector<cache_key_t> kk;
+            ModulePtrs todo = {m};
+            while (!todo.empty()) {
+                auto m0 = todo.back();
+                todo.pop_back();
+                if (!seen.insert(m0).second) continue;
+                kk.push_back(m0->source_key());
+                for (auto &m1 : imported[m0]) {
+                    todo.push_back(m1);
+                }
+            }
+            std::sort(kk.begin(), kk.end());
+            auto k = cache_hash(EGEL_CACHE_FORMAT);
+            for (auto k0 : kk) {
+                k = cache_hash(k0, k);
+            }
+            m->set_key(k);
+        }
+    }
+
     void reverse() {
         ModulePtrs ll;
         for (int i = _loading.size() - 1; i >= 0; i--) {
@@ -981,7 +1242,11 @@ protected:
         for (auto &m : _loading) {
             auto vals = m->values();
             for (auto &v : vals) {
-                _machine->eval_value(v.string());
+                if (auto r = m->result(_machine, v.string())) {
+                    _machine->define_value(v.string(), r);
+                } else {
+                    _machine->eval_value(v.string());
+                }
             }
         }
     }
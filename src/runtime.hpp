@@ -5,7 +5,9 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <complex>
 #include <cstring>
 #include <filesystem>
@@ -14,9 +16,12 @@
 #include <limits>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <set>
+#include <span>
 #include <sstream>
 #include <stack>
+#include <type_traits>
 #include <vector>
 
 #include "unicode/uchar.h"
@@ -71,6 +76,19 @@ inline void panic_fail(const char *message, const char *file,
 constexpr unsigned int EGEL_FLOAT_PRECISION =
     16;  // XXX: dbl::maxdigit doesn't seem to be defined on my system?
 
+// small integers and ascii characters are preallocated, immortal objects
+#ifndef EGEL_SMALL_INT_MIN
+#define EGEL_SMALL_INT_MIN -1024
+#endif
+
+#ifndef EGEL_SMALL_INT_MAX
+#define EGEL_SMALL_INT_MAX 65535
+#endif
+
+#ifndef EGEL_SMALL_CHAR_MAX
+#define EGEL_SMALL_CHAR_MAX 127
+#endif
+
 /**
  * VM objects are
  * + the literals, integer, float, char, and text,
@@ -108,6 +126,9 @@ const int SYMBOL_TUPLE = 9;
 const int SYMBOL_NIL = 10;
 const int SYMBOL_CONS = 11;
 
+const int SYMBOL_OBJECT = 12;
+const int SYMBOL_PROCESS = 13;
+
 /**
  * VM objects can have subtypes which are _unique_ 'magic' numbers.
  */
@@ -144,9 +165,168 @@ union vm_object_t {
     vm_object_t *next;
 };
 
+// an intrusive reference counted handle to egel values
+//
+// objects are counted with plain loads and stores while they are local
+// to the thread which created them. once an object escapes to another
+// thread (through async, proc, a shared container, or the data table)
+// it, and everything reachable from it, is marked shared and is counted
+// atomically from then on.
+
+template <typename T>
+class vm_ptr {
+public:
+    using element_type = T;
+
+    vm_ptr() noexcept : _ptr(nullptr) {
+    }
+
+    vm_ptr(std::nullptr_t) noexcept : _ptr(nullptr) {
+    }
+
+    explicit vm_ptr(T *p) noexcept : _ptr(p) {
+        if (_ptr != nullptr) _ptr->inc_ref();
+    }
+
+    vm_ptr(const vm_ptr &o) noexcept : _ptr(o._ptr) {
+        if (_ptr != nullptr) _ptr->inc_ref();
+    }
+
+    vm_ptr(vm_ptr &&o) noexcept : _ptr(o._ptr) {
+        o._ptr = nullptr;
+    }
+
+    template <typename U,
+              typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    vm_ptr(const vm_ptr<U> &o) noexcept : _ptr(o.get()) {
+        if (_ptr != nullptr) _ptr->inc_ref();
+    }
+
+    template <typename U,
+              typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    vm_ptr(vm_ptr<U> &&o) noexcept : _ptr(o.detach()) {
+    }
+
+    ~vm_ptr() {
+        if (_ptr != nullptr) _ptr->dec_ref();
+    }
+
+    vm_ptr &operator=(const vm_ptr &o) noexcept {
+        T *p = o._ptr;
+        if (p != nullptr) p->inc_ref();
+        T *q = _ptr;
+        _ptr = p;
+        if (q != nullptr) q->dec_ref();
+        return *this;
+    }
+
+    vm_ptr &operator=(vm_ptr &&o) noexcept {
+        if (this != &o) {
+            T *q = _ptr;
+            _ptr = o._ptr;
+            o._ptr = nullptr;
+            if (q != nullptr) q->dec_ref();
+        }
+        return *this;
+    }
+
+    vm_ptr &operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    void reset() noexcept {
+        T *q = _ptr;
+        _ptr = nullptr;
+        if (q != nullptr) q->dec_ref();
+    }
+
+    // give up ownership without decrementing the count
+    T *detach() noexcept {
+        T *p = _ptr;
+        _ptr = nullptr;
+        return p;
+    }
+
+    // take ownership of an already counted pointer
+    static vm_ptr attach(T *p) noexcept {
+        vm_ptr o;
+        o._ptr = p;
+        return o;
+    }
+
+    T *get() const noexcept {
+        return _ptr;
+    }
+
+    T &operator*() const noexcept {
+        return *_ptr;
+    }
+
+    T *operator->() const noexcept {
+        return _ptr;
+    }
+
+    explicit operator bool() const noexcept {
+        return _ptr != nullptr;
+    }
+
+    long use_count() const noexcept {
+        return (_ptr == nullptr) ? 0 : _ptr->ref_count();
+    }
+
+    void swap(vm_ptr &o) noexcept {
+        std::swap(_ptr, o._ptr);
+    }
+
+private:
+    T *_ptr;
+};
+
+template <typename T, typename U>
+inline bool operator==(const vm_ptr<T> &a, const vm_ptr<U> &b) noexcept {
+    return a.get() == b.get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const vm_ptr<T> &a, const vm_ptr<U> &b) noexcept {
+    return a.get() != b.get();
+}
+
+template <typename T, typename U>
+inline bool operator<(const vm_ptr<T> &a, const vm_ptr<U> &b) noexcept {
+    return std::less<const void *>()(a.get(), b.get());
+}
+
+template <typename T>
+inline bool operator==(const vm_ptr<T> &a, std::nullptr_t) noexcept {
+    return a.get() == nullptr;
+}
+
+template <typename T>
+inline bool operator!=(const vm_ptr<T> &a, std::nullptr_t) noexcept {
+    return a.get() != nullptr;
+}
+
+template <typename T, typename... Args>
+inline vm_ptr<T> make_vm_ptr(Args &&...args) {
+    return vm_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T, typename U>
+inline vm_ptr<T> vm_ptr_cast(const vm_ptr<U> &o) noexcept {
+    return vm_ptr<T>(static_cast<T *>(o.get()));
+}
+
+// reference counting modes, ordered by how far an object has escaped
+enum vm_refmode_t : uint8_t {
+    VM_REF_LOCAL,     // counted with plain arithmetic
+    VM_REF_SHARED,    // reachable from several threads, counted atomically
+    VM_REF_IMMORTAL,  // lives as long as the machine, not counted
+};
+
 class VMObject;
-using VMObjectPtr = std::shared_ptr<VMObject>;
-using VMWeakObjectPtr = std::weak_ptr<VMObject>;
+using VMObjectPtr = vm_ptr<VMObject>;
 
 class VMObject {
 public:
@@ -159,6 +339,8 @@ public:
     VMObject(const VMObject &o) : VMObject(o.tag(), o.subtag()) {
     }
 
+    VMObject &operator=(const VMObject &) = delete;
+
     virtual ~VMObject() {  // FIX: give a virtual destructor to keep the
                            // compiler(-s) happy
     }
@@ -205,11 +387,109 @@ public:
         return u;
     }
 
+    // reference counting
+    void inc_ref() const {
+        if (_refmode == VM_REF_LOCAL) {
+            _refcount++;
+        } else if (_refmode == VM_REF_SHARED) {
+            std::atomic_ref<vm_tagbits_t>(_refcount).fetch_add(
+                1, std::memory_order_relaxed);
+        }
+    }
+
+    void dec_ref() const {
+        if (release()) destroy();
+    }
+
+    // drop a reference without destroying, true when it was the last one
+    bool release() const {
+        if (_refmode == VM_REF_LOCAL) {
+            return --_refcount == 0;
+        } else if (_refmode == VM_REF_SHARED) {
+            return std::atomic_ref<vm_tagbits_t>(_refcount).fetch_sub(
+                       1, std::memory_order_acq_rel) == 1;
+        } else {
+            return false;
+        }
+    }
+
+    vm_tagbits_t ref_count() const {
+        if (_refmode == VM_REF_LOCAL) {
+            return _refcount;
+        } else {
+            return std::atomic_ref<vm_tagbits_t>(_refcount).load(
+                std::memory_order_relaxed);
+        }
+    }
+
+    vm_refmode_t refmode() const {
+        return _refmode;
+    }
+
+    bool is_shared() const {
+        return _refmode != VM_REF_LOCAL;
+    }
+
+    // mark this object and everything local reachable from it as shared,
+    // must be called by the owning thread before the object escapes
+    void share() const {
+        mark(VM_REF_SHARED);
+    }
+
+    // objects which live as long as the machine are not counted at all
+    void immortalize() const {
+        mark(VM_REF_IMMORTAL);
+    }
+
+    // data table entries live as long as the machine but what they hold is
+    // shared and counted, a redefined entry can then let go of it
+    void enshrine() const {
+        share();
+        _refmode = VM_REF_IMMORTAL;
+    }
+
+    // objects which hold other objects report them here. every container,
+    // including opaque objects in lib/, must report all it holds and share
+    // what is stored into it once it is shared itself, or its children are
+    // counted non-atomically from several threads
+    virtual void shared_children(std::vector<const VMObject *> &oo) const {
+    }
+
+    // a data table entry which is redefined hands over what it holds, it
+    // may still be reduced through stale references
+    virtual VMObjectPtr retire() const {
+        return nullptr;
+    }
+
 private:
+    void mark(vm_refmode_t m) const {
+        std::vector<const VMObject *> todo;
+        todo.push_back(this);
+        while (!todo.empty()) {
+            auto o = todo.back();
+            todo.pop_back();
+            if (o->_refmode == VM_REF_LOCAL) {
+                o->_refmode = m;
+                o->shared_children(todo);
+            }
+        }
+    }
+
+    [[gnu::noinline]] void destroy() const {
+        delete this;
+    }
+
     vm_tag_t _tag;
     vm_subtag_t _subtag;
+    alignas(std::atomic_ref<vm_tagbits_t>::required_alignment) mutable
+        vm_tagbits_t _refcount = 0;
+    mutable vm_refmode_t _refmode = VM_REF_LOCAL;
 };
 
+inline void share_object(const VMObjectPtr &o) {
+    if (o != nullptr) o->share();
+}
+
 inline bool object_symbol_test(const VMObjectPtr &o, const symbol_t s) {
     return o->symbol() == s;
 };
@@ -246,6 +526,20 @@ using UnicodeStrings = std::vector<icu::UnicodeString>;
 class Options;
 using OptionsPtr = std::shared_ptr<Options>;
 
+// bytecode is compiled to native code when loaded, once it is hot, or never
+enum jit_mode_t {
+    JIT_OFF,
+    JIT_LAZY,
+    JIT_EAGER,
+};
+
+// a build without GNU lightning has only the interpreter
+#ifdef EGEL_LIGHTNING
+#define JIT_DEFAULT JIT_EAGER
+#else
+#define JIT_DEFAULT JIT_OFF
+#endif
+
 class Options {
 public:
     Options()
@@ -255,7 +549,8 @@ public:
           _semantical_flag(false),
           _desugar_flag(false),
           _lift_flag(false),
-          _bytecode_flag(false) {
+          _bytecode_flag(false),
+          _jit_mode(JIT_DEFAULT) {
         _include_path = UnicodeStrings();
     }
 
@@ -268,6 +563,7 @@ public:
           _desugar_flag(d),
           _lift_flag(l),
           _bytecode_flag(b),
+          _jit_mode(JIT_DEFAULT),
           _include_path(ii) {
     }
 
@@ -279,7 +575,9 @@ public:
           _desugar_flag(o._desugar_flag),
           _lift_flag(o._lift_flag),
           _bytecode_flag(o._bytecode_flag),
-          _include_path(o._include_path) {
+          _jit_mode(o._jit_mode),
+          _include_path(o._include_path),
+          _cache(o._cache) {
     }
 
     static OptionsPtr create() {
@@ -378,6 +676,42 @@ public:
         return _bytecode_flag;
     }
 
+    void set_jit(jit_mode_t m) {
+#ifdef EGEL_LIGHTNING
+        _jit_mode = m;
+#else
+        _jit_mode = JIT_OFF;
+#endif
+    }
+
+    jit_mode_t jit() const {
+        return _jit_mode;
+    }
+
+    // the directory compiled modules are cached in, none if empty
+    void set_cache(const icu::UnicodeString &d) {
+        _cache = d;
+    }
+
+    icu::UnicodeString cache() const {
+        return _cache;
+    }
+
+    bool use_cache() const {
+        return (_cache != "") && !_tokenize_flag && !_unparse_flag &&
+               !_semantical_flag && !_desugar_flag && !_lift_flag &&
+               !_bytecode_flag;
+    }
+
+    // imported modules share the settings but not the debug output
+    OptionsPtr imported() const {
+        auto o = std::make_shared<Options>();
+        o->_jit_mode = _jit_mode;
+        o->_include_path = _include_path;
+        o->_cache = _cache;
+        return o;
+    }
+
     void render(std::ostream &os) const {
         os << "interactive:" << _interactive_flag << std::endl;
         os << "tokenize:   " << _tokenize_flag << std::endl;
@@ -386,6 +720,8 @@ public:
         os << "desugar:    " << _desugar_flag << std::endl;
         os << "lift:       " << _lift_flag << std::endl;
         os << "bytecode:   " << _bytecode_flag << std::endl;
+        os << "jit:        " << _jit_mode << std::endl;
+        os << "cache:      " << _cache << std::endl;
         os << "include:    ";
         for (auto &i : _include_path) {
             os << i << ":";
@@ -406,12 +742,22 @@ private:
     bool _desugar_flag;
     bool _lift_flag;
     bool _bytecode_flag;
+    jit_mode_t _jit_mode;
     UnicodeStrings _include_path;
+    icu::UnicodeString _cache;
+};
+
+// thunks which the reducers rewrite into results or tail calls are updated
+// in place when nobody else holds them, otherwise they are copied
+struct vm_frame_stats_t {
+    uint64_t reused;     // frames updated in place
+    uint64_t allocated;  // frames copied
 };
 
 struct VMReduceResult {
     VMObjectPtr result;
-    bool exception;
+    bool exception = false;
+    vm_frame_stats_t frames = {};  // of this reduction
 };
 
 enum reducer_state_t { RUNNING, SLEEPING, HALTED };
@@ -502,6 +848,9 @@ public:
     virtual VMObjectPtr create_complex(const vm_complex_t b) = 0;
     virtual VMObjectPtr create_char(const vm_char_t b) = 0;
     virtual VMObjectPtr create_text(const vm_text_t b) = 0;
+    virtual VMObjectPtr create_text_slice(const VMObjectPtr &o,
+                                          const vm_int_t start,
+                                          const vm_int_t length) = 0;
 
     virtual bool is_integer(const VMObjectPtr &o) = 0;
     virtual bool is_float(const VMObjectPtr &o) = 0;
@@ -514,7 +863,7 @@ public:
     virtual vm_float_t get_float(const VMObjectPtr &o) = 0;
     virtual vm_complex_t get_complex(const VMObjectPtr &o) = 0;
     virtual vm_char_t get_char(const VMObjectPtr &o) = 0;
-    virtual vm_text_t get_text(const VMObjectPtr &o) = 0;
+    virtual const vm_text_t &get_text(const VMObjectPtr &o) = 0;
 
     virtual VMObjectPtr create_none() = 0;
     virtual VMObjectPtr create_true() = 0;
@@ -631,6 +980,10 @@ public:
     virtual void eval_main() = 0;
     virtual void eval_interactive() = 0;
     virtual void eval_value(const icu::UnicodeString &v) = 0;
+    virtual void define_value(const icu::UnicodeString &v,
+                              const VMObjectPtr &o) = 0;
+    virtual void eval_image(const icu::UnicodeString &fn) = 0;
+    virtual void save_image(const icu::UnicodeString &fn) = 0;
 
     // expose the tokenizer
     virtual VMObjectPtr tokenize(const icu::UnicodeString &uri,
@@ -660,8 +1013,13 @@ public:
     virtual VMObjectPtrs get_bytedata(const VMObjectPtr &o) = 0;
     virtual icu::UnicodeString serialize(const VMObjectPtr &o) = 0;
     virtual VMObjectPtr deserialize(const icu::UnicodeString &s) = 0;
+    virtual std::string serialize_binary(const VMObjectPtr &o) = 0;
+    virtual VMObjectPtr deserialize_binary(const std::string &s) = 0;
     virtual VMObjectPtrs dependencies(const VMObjectPtr &o) = 0;
 
+    // native code, compile and swap in a bytecode combinator
+    virtual VMObjectPtr compile(const VMObjectPtr &o) = 0;
+
     virtual int compare(const VMObjectPtr &o0, const VMObjectPtr &o1) = 0;
 
     virtual VMObjectPtr bad(const VMObject *o, const icu::UnicodeString &e) = 0;
@@ -999,6 +1357,120 @@ public:
 // stuff below is either for internal usage or for implementations which just
 // need that bit of extra speed
 
+// per-thread free lists for the small objects the reducer allocates most,
+// i.e., literals, arrays, and thunk slots. blocks are binned in size
+// classes of eight bytes; a block freed by another thread than the one
+// which allocated it simply migrates to the free list of that thread.
+
+struct vm_pool_stats_t {
+    uint64_t hits;    // allocations served from a free list
+    uint64_t misses;  // allocations which fell through to operator new
+};
+
+class VMPool {
+public:
+    static constexpr size_t GRANULE = 8;
+    static constexpr size_t CLASSES = 32;
+    static constexpr size_t MAX_FREE = 1 << 16;  // per class, per thread
+
+    static void *allocate(size_t sz) {
+        auto c = (sz - 1) / GRANULE;
+        if (c >= CLASSES) {
+            return ::operator new(sz);
+        }
+        auto &l = _local;
+        auto b = l.free[c];
+        if (b != nullptr) {
+            l.free[c] = b->next;
+            l.length[c]--;
+            l.stats[c].hits++;
+            return b;
+        } else {
+            l.stats[c].misses++;
+            return ::operator new((c + 1) * GRANULE);
+        }
+    }
+
+    static void deallocate(void *p, size_t sz) {
+        auto c = (sz - 1) / GRANULE;
+        auto &l = _local;
+        if ((c >= CLASSES) || (l.length[c] >= MAX_FREE) || l.closed) {
+            ::operator delete(p);
+            return;
+        }
+        if (!l.registered) {
+            l.registered = true;
+            _reaper.touch();
+        }
+        auto b = static_cast<block_t *>(p);
+        b->next = l.free[c];
+        l.free[c] = b;
+        l.length[c]++;
+    }
+
+    // statistics of exited threads plus those of the calling thread
+    static vm_pool_stats_t stats(size_t c) {
+        vm_pool_stats_t s;
+        s.hits = _retired_hits[c].load() + _local.stats[c].hits;
+        s.misses = _retired_misses[c].load() + _local.stats[c].misses;
+        return s;
+    }
+
+    static size_t class_size(size_t c) {
+        return (c + 1) * GRANULE;
+    }
+
+private:
+    struct block_t {
+        block_t *next;
+    };
+
+    // trivially destructible such that it outlives every other thread local
+    struct local_t {
+        block_t *free[CLASSES];
+        size_t length[CLASSES];
+        vm_pool_stats_t stats[CLASSES];
+        bool registered;
+        bool closed;
+    };
+
+    // returns the free lists of a thread to the system on exit
+    struct reaper_t {
+        void touch() {
+        }
+
+        ~reaper_t() {
+            auto &l = _local;
+            for (size_t c = 0; c < CLASSES; c++) {
+                while (l.free[c] != nullptr) {
+                    auto b = l.free[c];
+                    l.free[c] = b->next;
+                    ::operator delete(b);
+                }
+                l.length[c] = 0;
+                _retired_hits[c] += l.stats[c].hits;
+                _retired_misses[c] += l.stats[c].misses;
+                l.stats[c] = vm_pool_stats_t{0, 0};
+            }
+            l.closed = true;
+        }
+    };
+
+    static inline thread_local local_t _local = {};
+    static inline thread_local reaper_t _reaper;
+    static inline std::atomic<uint64_t> _retired_hits[CLASSES] = {};
+    static inline std::atomic<uint64_t> _retired_misses[CLASSES] = {};
+};
+
+// objects allocated from the pool
+#define VM_POOLED                                     \
+    static void *operator new(size_t sz) {            \
+        return VMPool::allocate(sz);                  \
+    }                                                 \
+    static void operator delete(void *p, size_t sz) { \
+        VMPool::deallocate(p, sz);                    \
+    }
+
 // VM object definitions
 
 class VMObjectLiteral : public VMObject {
@@ -1012,6 +1484,8 @@ public:
 
 class VMObjectInteger : public VMObjectLiteral {
 public:
+    VM_POOLED
+
     VMObjectInteger(const vm_int_t &v)
         : VMObjectLiteral(VM_OBJECT_INTEGER), _value(v) {};
 
@@ -1019,21 +1493,36 @@ public:
     }
 
     static VMObjectPtr create(const vm_int_t v) {
-        return std::make_shared<VMObjectInteger>(v);
+        if ((v >= EGEL_SMALL_INT_MIN) && (v <= EGEL_SMALL_INT_MAX)) {
+            return VMObjectPtr::attach(
+                &small_integers()[v - EGEL_SMALL_INT_MIN]);
+        } else {
+            return make_vm_ptr<VMObjectInteger>(v);
+        }
     }
 
     static bool test(const VMObjectPtr &o) {
-        return o->tag() == VM_OBJECT_INTEGER;
+        return is_small(o.get()) || (o->tag() == VM_OBJECT_INTEGER);
     }
 
-    static std::shared_ptr<VMObjectInteger> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectInteger>(o);
+    static vm_ptr<VMObjectInteger> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectInteger>(o);
     }
 
     static vm_int_t value(const VMObjectPtr &o) {
-        return cast(o)->value();
+        auto p = o.get();
+        if (is_small(p)) {
+            return small_value(p);
+        } else {
+            return static_cast<const VMObjectInteger *>(p)->value();
+        }
     }
 
+    // a handle to a small integer encodes its value in its address
+    static bool is_small(const VMObject *o);
+
+    static vm_int_t small_value(const VMObject *o);
+
     symbol_t symbol() const override {
         return SYMBOL_INT;
     }
@@ -1047,11 +1536,47 @@ public:
     }
 
 private:
+    static VMObjectInteger *small_integers();
+
     vm_int_t _value;
 };
 
+// small integers live in a static table ordered by value, handles to them
+// are tested, read, and compared without being dereferenced
+
+alignas(VMObjectInteger) inline std::byte
+    vm_small_integers[(EGEL_SMALL_INT_MAX - EGEL_SMALL_INT_MIN + 1) *
+                      sizeof(VMObjectInteger)];
+
+inline bool VMObjectInteger::is_small(const VMObject *o) {
+    return reinterpret_cast<uintptr_t>(o) -
+               reinterpret_cast<uintptr_t>(vm_small_integers) <
+           sizeof(vm_small_integers);
+}
+
+inline vm_int_t VMObjectInteger::small_value(const VMObject *o) {
+    auto d = reinterpret_cast<const std::byte *>(o) - vm_small_integers;
+    return EGEL_SMALL_INT_MIN +
+           static_cast<vm_int_t>(d / sizeof(VMObjectInteger));
+}
+
+inline VMObjectInteger *VMObjectInteger::small_integers() {
+    static VMObjectInteger *table = [] {
+        constexpr auto n = EGEL_SMALL_INT_MAX - EGEL_SMALL_INT_MIN + 1;
+        auto tt = reinterpret_cast<VMObjectInteger *>(vm_small_integers);
+        for (vm_int_t i = 0; i < n; i++) {
+            auto o = ::new (&tt[i]) VMObjectInteger(i + EGEL_SMALL_INT_MIN);
+            o->immortalize();
+        }
+        return tt;
+    }();
+    return table;
+}
+
 class VMObjectFloat : public VMObjectLiteral {
 public:
+    VM_POOLED
+
     VMObjectFloat(const vm_float_t &v)
         : VMObjectLiteral(VM_OBJECT_FLOAT), _value(v) {};
 
@@ -1059,15 +1584,15 @@ public:
     }
 
     static VMObjectPtr create(const vm_float_t f) {
-        return std::make_shared<VMObjectFloat>(f);
+        return make_vm_ptr<VMObjectFloat>(f);
     }
 
     static bool test(const VMObjectPtr &o) {
         return o->tag() == VM_OBJECT_FLOAT;
     }
 
-    static std::shared_ptr<VMObjectFloat> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectFloat>(o);
+    static vm_ptr<VMObjectFloat> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectFloat>(o);
     }
 
     static vm_float_t value(const VMObjectPtr &o) {
@@ -1100,15 +1625,15 @@ public:
     }
 
     static VMObjectPtr create(const vm_complex_t f) {
-        return std::make_shared<VMObjectComplex>(f);
+        return make_vm_ptr<VMObjectComplex>(f);
     }
 
     static bool test(const VMObjectPtr &o) {
         return o->tag() == VM_OBJECT_COMPLEX;
     }
 
-    static std::shared_ptr<VMObjectComplex> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectComplex>(o);
+    static vm_ptr<VMObjectComplex> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectComplex>(o);
     }
 
     static vm_complex_t value(const VMObjectPtr &o) {
@@ -1140,6 +1665,8 @@ private:
 
 class VMObjectChar : public VMObjectLiteral {
 public:
+    VM_POOLED
+
     VMObjectChar(const vm_char_t &v)
         : VMObjectLiteral(VM_OBJECT_CHAR), _value(v) {};
 
@@ -1147,21 +1674,35 @@ public:
     }
 
     static VMObjectPtr create(const vm_char_t v) {
-        return std::make_shared<VMObjectChar>(v);
+        if ((v >= 0) && (v <= EGEL_SMALL_CHAR_MAX)) {
+            return VMObjectPtr::attach(&small_chars()[v]);
+        } else {
+            return make_vm_ptr<VMObjectChar>(v);
+        }
     }
 
     static bool test(const VMObjectPtr &o) {
-        return o->tag() == VM_OBJECT_CHAR;
+        return is_small(o.get()) || (o->tag() == VM_OBJECT_CHAR);
     }
 
-    static std::shared_ptr<VMObjectChar> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectChar>(o);
+    static vm_ptr<VMObjectChar> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectChar>(o);
     }
 
     static vm_char_t value(const VMObjectPtr &o) {
-        return cast(o)->value();
+        auto p = o.get();
+        if (is_small(p)) {
+            return small_value(p);
+        } else {
+            return static_cast<const VMObjectChar *>(p)->value();
+        }
     }
 
+    // a handle to a small character encodes it in its address
+    static bool is_small(const VMObject *o);
+
+    static vm_char_t small_value(const VMObject *o);
+
     symbol_t symbol() const override {
         return SYMBOL_CHAR;
     }
@@ -1177,14 +1718,51 @@ public:
     }
 
 private:
+    static VMObjectChar *small_chars();
+
     vm_char_t _value;
 };
 
+alignas(VMObjectChar) inline std::byte
+    vm_small_chars[(EGEL_SMALL_CHAR_MAX + 1) * sizeof(VMObjectChar)];
+
+inline bool VMObjectChar::is_small(const VMObject *o) {
+    return reinterpret_cast<uintptr_t>(o) -
+               reinterpret_cast<uintptr_t>(vm_small_chars) <
+           sizeof(vm_small_chars);
+}
+
+inline vm_char_t VMObjectChar::small_value(const VMObject *o) {
+    auto d = reinterpret_cast<const std::byte *>(o) - vm_small_chars;
+    return static_cast<vm_char_t>(d / sizeof(VMObjectChar));
+}
+
+inline VMObjectChar *VMObjectChar::small_chars() {
+    static VMObjectChar *table = [] {
+        constexpr auto n = EGEL_SMALL_CHAR_MAX + 1;
+        auto tt = reinterpret_cast<VMObjectChar *>(vm_small_chars);
+        for (vm_char_t c = 0; c < n; c++) {
+            auto o = ::new (&tt[c]) VMObjectChar(c);
+            o->immortalize();
+        }
+        return tt;
+    }();
+    return table;
+}
+
+// texts are immutable, a slice of a long text is a read-only alias into
+// the buffer of the text it was taken from, which it keeps alive
+
 class VMObjectText : public VMObjectLiteral {
 public:
+    VM_POOLED
+
     VMObjectText(const icu::UnicodeString &v)
         : VMObjectLiteral(VM_OBJECT_TEXT), _value(v) {};
 
+    VMObjectText(icu::UnicodeString &&v)
+        : VMObjectLiteral(VM_OBJECT_TEXT), _value(std::move(v)) {};
+
     VMObjectText(const char *v) : VMObjectLiteral(VM_OBJECT_TEXT) {
         _value = icu::UnicodeString::fromUTF8(icu::StringPiece(v));
     };
@@ -1193,25 +1771,58 @@ public:
     }
 
     static VMObjectPtr create(const icu::UnicodeString &v) {
-        return std::make_shared<VMObjectText>(v);
+        return make_vm_ptr<VMObjectText>(v);
+    }
+
+    static VMObjectPtr create(icu::UnicodeString &&v) {
+        return make_vm_ptr<VMObjectText>(std::move(v));
     }
 
     static VMObjectPtr create(const char *v) {
-        return std::make_shared<VMObjectText>(v);
+        return make_vm_ptr<VMObjectText>(v);
+    }
+
+    // the code units [start, start + length) of a text, pinned to it like
+    // icu does. a slice keeps the whole buffer of its owner alive, so only
+    // slices of at least a fraction of that buffer alias it; shorter ones,
+    // and those which fit inline anyway, are copied
+    static VMObjectPtr create_slice(const VMObjectPtr &o, int32_t start,
+                                    int32_t length) {
+        auto t = static_cast<const VMObjectText *>(o.get());
+        auto &v = t->_value;
+        start = std::clamp(start, 0, v.length());
+        length = std::clamp(length, 0, v.length() - start);
+        auto &w = (t->_owner == nullptr) ? o : t->_owner;
+        auto n = static_cast<const VMObjectText *>(w.get())->_value.length();
+        if ((start == 0) && (length == v.length())) {
+            return o;
+        } else if ((length < SLICE_MIN) || (length < n / SLICE_FRACTION)) {
+            return create(icu::UnicodeString(v, start, length));
+        } else {
+            auto u = icu::UnicodeString(false, v.getBuffer() + start, length);
+            auto s = make_vm_ptr<VMObjectText>(std::move(u));
+            s->_owner = w;
+            return s;
+        }
     }
 
     static bool test(const VMObjectPtr &o) {
         return o->tag() == VM_OBJECT_TEXT;
     }
 
-    static std::shared_ptr<VMObjectText> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectText>(o);
+    static vm_ptr<VMObjectText> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectText>(o);
     }
 
     static icu::UnicodeString value(const VMObjectPtr &o) {
         return cast(o)->value();
     }
 
+    // the text borrowed without copying, valid while the object is
+    static const icu::UnicodeString &value_ref(const VMObjectPtr &o) {
+        return static_cast<const VMObjectText *>(o.get())->_value;
+    }
+
     symbol_t symbol() const override {
         return SYMBOL_TEXT;
     }
@@ -1234,8 +1845,35 @@ public:
         return _value;
     }
 
+    const icu::UnicodeString &value_ref() const {
+        return _value;
+    }
+
+    // texts are immutable, the hash is computed once. threads which share
+    // the text may race to store it, but they store the same value
+    size_t hash() const {
+        std::atomic_ref<uint32_t> h(_hash);
+        auto v = h.load(std::memory_order_relaxed);
+        if (v == 0) {
+            v = static_cast<uint32_t>(_value.hashCode()) | 1;
+            h.store(v, std::memory_order_relaxed);
+        }
+        return v;
+    }
+
+    void shared_children(std::vector<const VMObject *> &oo) const override {
+        if (_owner != nullptr) oo.push_back(_owner.get());
+    }
+
 private:
+    // icu keeps up to 27 code units inline
+    static constexpr int32_t SLICE_MIN = 32;
+    // a slice pins at most this many times its own length
+    static constexpr int32_t SLICE_FRACTION = 4;
+
     icu::UnicodeString _value;
+    VMObjectPtr _owner;  // the text a slice aliases
+    mutable uint32_t _hash = 0;
 };
 
 class VMObjectRawText : public VMObjectText {
@@ -1246,7 +1884,7 @@ public:
     }
 
     static VMObjectPtr create(const icu::UnicodeString &v) {
-        return std::make_shared<VMObjectRawText>(v);
+        return make_vm_ptr<VMObjectRawText>(v);
     }
 
     void render(std::ostream &os) const override {
@@ -1254,78 +1892,91 @@ public:
     }
 };
 
-#define GC_STOPGAP yes
-
-#ifdef GC_STOPGAP
-inline thread_local std::stack<VMObjectPtr> defer;
-inline thread_local bool deferring = false;
-#endif
+// arrays are allocated in one block with their slots trailing the
+// header, they are created with create or make only
 
 class VMObjectArray : public VMObject {
 public:
-    VMObjectArray() : VMObject(VM_OBJECT_ARRAY) {
-        _size = 0;
-        _array = new VMObjectPtr[0];
-    };
+    VMObjectArray() : VMObjectArray(0) {
+    }
 
-    VMObjectArray(const VMObjectPtrs &v) : VMObject(VM_OBJECT_ARRAY) {
-        _size = v.size();
-        ;
-        _array = new VMObjectPtr[_size];
+    VMObjectArray(const VMObjectPtrs &v) : VMObjectArray(v.size()) {
         for (int i = 0; i < _size; i++) {
-            _array[i] = v[i];
+            _array()[i] = v[i];
         }
     }
 
-    VMObjectArray(const VMObjectArray &l) : VMObject(VM_OBJECT_ARRAY) {
-        _size = l._size;
-        _array = new VMObjectPtr[_size];
+    VMObjectArray(const VMObjectArray &l) : VMObjectArray(l._size) {
         for (int i = 0; i < _size; i++) {
-            _array[i] = l._array[i];
+            _array()[i] = l._array()[i];
         }
     }
 
     VMObjectArray(const int size) : VMObject(VM_OBJECT_ARRAY) {
         _size = size;
-        _array = new VMObjectPtr[size];
+        _capacity = size;
+        std::uninitialized_value_construct_n(_array(), size);
+    }
+
+    static void *operator new(size_t sz, int capacity) {
+        return VMPool::allocate(sz + capacity * sizeof(VMObjectPtr));
+    }
+
+    static void operator delete(VMObjectArray *p, std::destroying_delete_t) {
+        auto sz = sizeof(VMObjectArray) + p->_capacity * sizeof(VMObjectPtr);
+        p->~VMObjectArray();
+        VMPool::deallocate(p, sz);
+    }
+
+    template <typename... Args>
+    static vm_ptr<VMObjectArray> make(int capacity, Args &&...args) {
+        return vm_ptr<VMObjectArray>(
+            new (capacity) VMObjectArray(std::forward<Args>(args)...));
     }
 
+    // arrays which die along with this one are chained through their
+    // dead hash field instead of being deleted recursively, the outermost
+    // teardown on the thread then deletes the chain. dropping a large
+    // structure thus neither recurses nor allocates
     ~VMObjectArray() {
-#ifdef GC_STOPGAP
-        if (deferring) {
-            for (int i = 0; i < _size; i++) {
-                defer.push(_array[i]);
-            }
-            delete[] _array;
-        } else {
-            deferring = true;
-            for (int i = 0; i < _size; i++) {
-                defer.push(_array[i]);
+        auto pp = _array();
+        for (int i = 0; i < _size; i++) {
+            auto o = pp[i].detach();
+            if ((o != nullptr) && o->release()) {
+                if (o->tag() == VM_OBJECT_ARRAY) {
+                    auto a = static_cast<VMObjectArray *>(o);
+                    a->_next = _dead;
+                    _dead = a;
+                } else {
+                    delete o;
+                }
             }
-            delete[] _array;
-            while (!defer.empty()) {
-                defer.pop();
+        }
+        std::destroy_n(pp, _capacity);
+        if (!_reclaiming) {
+            _reclaiming = true;
+            while (_dead != nullptr) {
+                auto a = _dead;
+                _dead = a->_next;
+                delete a;
             }
-            deferring = false;
+            _reclaiming = false;
         }
-#else
-        delete[] _array;
-#endif
     }
 
     VMObjectPtr clone() const {
-        return std::make_shared<VMObjectArray>(*this);
+        return make(_size, *this);
     }
 
     static VMObjectPtr create(int size) {
-        return std::make_shared<VMObjectArray>(size);
+        return make(size, size);
     }
 
     static VMObjectPtr create(const VMObjectPtrs &pp) {
         if (pp.size() == 1) {
             return pp[0];
         } else {
-            return std::make_shared<VMObjectArray>(pp);
+            return make(pp.size(), pp);
         }
     }
 
@@ -1333,7 +1984,7 @@ public:
         if (sz == 1) {
             return pp[0];
         } else {
-            auto aa = std::static_pointer_cast<VMObjectArray>(create(sz));
+            auto aa = vm_ptr_cast<VMObjectArray>(create(sz));
             for (size_t n = 0; n < sz; n++) {
                 aa->set(n, pp[n]);
             }
@@ -1346,12 +1997,61 @@ public:
         ;
     }
 
-    static std::shared_ptr<VMObjectArray> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectArray>(o);
+    // the slots of a thunk, borrowed without copying or counting
+    static const VMObjectArray &slots(const VMObjectPtr &o) {
+        return *static_cast<const VMObjectArray *>(o.get());
     }
 
-    static VMObjectPtrs value(const VMObjectPtr &o) {
-        return cast(o)->value();
+    // the thunk without the slots [i, i + n), a single remaining slot is
+    // returned as is. a thunk only the trampoline refers to is dead after
+    // the rewrite and is updated in place
+    static VMObjectPtr erase(const VMObjectPtr &thunk, size_t i, size_t n) {
+        auto tt = static_cast<VMObjectArray *>(thunk.get());
+        size_t sz = tt->_size - n;
+        auto pp = tt->_array();
+        if (sz == 1) {
+            return (i == 0) ? pp[n] : pp[0];
+        } else if (tt->unique()) {
+            for (size_t j = i; j < sz; j++) {
+                pp[j] = std::move(pp[j + n]);
+            }
+            for (size_t j = sz; j < tt->size(); j++) {
+                pp[j] = nullptr;
+            }
+            tt->_size = sz;
+            tt->_hash = 0;
+            _frame_stats.reused++;
+            return thunk;
+        } else {
+            auto aa = make(sz, sz);
+            auto qq = aa->_array();
+            for (size_t j = 0; j < i; j++) {
+                qq[j] = pp[j];
+            }
+            for (size_t j = i; j < sz; j++) {
+                qq[j] = pp[j + n];
+            }
+            _frame_stats.allocated++;
+            return aa;
+        }
+    }
+
+    // frame statistics of the calling thread
+    static vm_frame_stats_t &frame_stats() {
+        return _frame_stats;
+    }
+
+    bool unique() const {
+        return (refmode() == VM_REF_LOCAL) && (ref_count() == 1);
+    }
+
+    static vm_ptr<VMObjectArray> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectArray>(o);
+    }
+
+    // the slots of an array, valid while the array is
+    static std::span<const VMObjectPtr> value(const VMObjectPtr &o) {
+        return slots(o).value();
     }
 
     symbol_t symbol() const override {
@@ -1363,31 +2063,37 @@ public:
     }
 
     VMObjectPtr &operator[](const size_t i) {
-        return _array[i];
+        return _array()[i];
     }
 
     const VMObjectPtr &operator[](const size_t i) const {
-        return _array[i];
+        return _array()[i];
     }
 
     // deprecate
     VMObjectPtr get(unsigned int i) const {
-        return _array[i];
+        return _array()[i];
     }
 
     // deprecate
     void set(unsigned int i, const VMObjectPtr &o) {
-        _array[i] = o;
+        _array()[i] = o;
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override;
 
-    VMObjectPtrs value() const {
-        auto oo = VMObjectPtrs(_size);
+    // structural hash, computed once; only values are hashed, and those are
+    // never rewritten in place
+    size_t hash() const;
+
+    void shared_children(std::vector<const VMObject *> &oo) const override {
         for (int i = 0; i < _size; i++) {
-            oo[i] = _array[i];
+            if (_array()[i] != nullptr) oo.push_back(_array()[i].get());
         }
-        return oo;
+    }
+
+    std::span<const VMObjectPtr> value() const {
+        return {_array(), static_cast<size_t>(_size)};
     }
 
     bool is_well_formed_tuple(VMObjectPtr &ee) const;
@@ -1399,21 +2105,35 @@ public:
     void render(std::ostream &os) const override;
 
 private:
-    VMObjectPtr *_array;
+    // the slots trail the header
+    VMObjectPtr *_array() const {
+        return reinterpret_cast<VMObjectPtr *>(
+            const_cast<VMObjectArray *>(this) + 1);
+    }
+
     int _size;
+    int _capacity;  // slots past the size are null
+    union {
+        mutable uint32_t _hash = 0;
+        VMObjectArray *_next;  // once dead, the next in the teardown chain
+    };
+
+    static inline thread_local vm_frame_stats_t _frame_stats = {};
+    static inline thread_local VMObjectArray *_dead = nullptr;
+    static inline thread_local bool _reclaiming = false;
 };
 
 // here we can safely declare reduce
 inline VMObjectPtr VMObjectLiteral::reduce(const VMObjectPtr &thunk) const {
-    auto tt = VMObjectArray::cast(thunk);
+    auto &tt = VMObjectArray::slots(thunk);
     // optimize a bit for the case it's either a sole literal or an applied
     // literal
-    if (tt->size() == 5) {
-        auto rt = tt->get(0);
-        auto rti = tt->get(1);
-        auto k = tt->get(2);
+    if (tt.size() == 5) {
+        auto rt = tt[0];
+        auto rti = tt[1];
+        auto k = tt[2];
         // auto exc   = tt[3];
-        auto c = tt->get(4);
+        auto c = tt[4];
 
         auto index = VMObjectInteger::value(rti);
         auto rta = VMObjectArray::cast(rt);
@@ -1421,16 +2141,11 @@ inline VMObjectPtr VMObjectLiteral::reduce(const VMObjectPtr &thunk) const {
 
         return k;
     } else {
-        auto rt = tt->get(0);
-        auto rti = tt->get(1);
-        auto k = tt->get(2);
-
-        VMObjectPtrs vv;
-        for (size_t n = 4; n < tt->size(); n++) {
-            vv.push_back(tt->get(n));
-        }
+        auto rt = tt[0];
+        auto rti = tt[1];
+        auto k = tt[2];
 
-        auto r = VMObjectArray::create(vv);
+        auto r = VMObjectArray::erase(thunk, 0, 4);
 
         auto index = VMObjectInteger::value(rti);
         auto rta = VMObjectArray::cast(rt);
@@ -1441,29 +2156,44 @@ inline VMObjectPtr VMObjectLiteral::reduce(const VMObjectPtr &thunk) const {
 };
 
 inline VMObjectPtr VMObjectArray::reduce(const VMObjectPtr &thunk) const {
-    auto tt = VMObjectArray::value(thunk);
-    auto rt = tt[0];
-    auto rti = tt[1];
-    auto k = tt[2];
-    auto exc = tt[3];
-    auto c = tt[4];
-
-    VMObjectPtrs vv;
-    vv.push_back(rt);
-    vv.push_back(rti);
-    vv.push_back(k);
-    vv.push_back(exc);
-    auto aa = VMObjectArray::value(c);
-    for (auto &a : aa) {
-        vv.push_back(a);
-    }
-    for (unsigned int n = 5; n < tt.size(); n++) {
-        vv.push_back(tt[n]);
+    // the applied array is spliced into the thunk, in place when it is
+    // dead and has room
+    auto tt = static_cast<VMObjectArray *>(thunk.get());
+    auto &aa = VMObjectArray::slots((*tt)[4]);
+    size_t sz = tt->size() - 1 + aa.size();
+    if (tt->unique() && (aa.size() > 1) && (sz <= (size_t)tt->_capacity)) {
+        auto c = std::move((*tt)[4]);
+        auto pp = tt->_array();
+        // trailing arguments move up, the last one first
+        for (size_t n = tt->_size; n-- > 5;) {
+            pp[n - 1 + aa.size()] = std::move(pp[n]);
+        }
+        for (size_t n = 0; n < aa.size(); n++) {
+            pp[4 + n] = aa[n];
+        }
+        tt->_size = sz;
+        tt->_hash = 0;
+        _frame_stats.reused++;
+        return thunk;
+    } else {
+        // the slots of a dead thunk move over rather than being copied
+        bool dead = tt->unique();
+        auto t = make(sz, sz);
+        auto pp = tt->_array();
+        auto qq = t->_array();
+        size_t j = 0;
+        for (size_t n = 0; n < 4; n++) {
+            qq[j++] = dead ? std::move(pp[n]) : pp[n];
+        }
+        for (size_t n = 0; n < aa.size(); n++) {
+            qq[j++] = aa[n];
+        }
+        for (size_t n = 5; n < tt->size(); n++) {
+            qq[j++] = dead ? std::move(pp[n]) : pp[n];
+        }
+        _frame_stats.allocated++;
+        return t;
     }
-
-    auto t = VMObjectArray::create(vv);
-
-    return t;
 }
 
 class VMObjectOpaque : public VMObject {
@@ -1497,8 +2227,8 @@ public:
         return o->tag() == VM_OBJECT_OPAQUE;
     }
 
-    static std::shared_ptr<VMObjectOpaque> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectOpaque>(o);
+    static vm_ptr<VMObjectOpaque> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectOpaque>(o);
     }
 
     static int compare(const VMObjectPtr &o0, const VMObjectPtr &o1) {
@@ -1518,7 +2248,7 @@ public:
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
@@ -1527,11 +2257,7 @@ public:
 
         VMObjectPtr ret;
         if (tt.size() > 5) {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            ret = VMObjectArray::create(rr);
+            ret = VMObjectArray::erase(thunk, 0, 4);
         } else {
             ret = tt[4];
         }
@@ -1602,8 +2328,8 @@ public:
         return o->tag() == VM_OBJECT_COMBINATOR;
     }
 
-    static std::shared_ptr<VMObjectCombinator> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectCombinator>(o);
+    static vm_ptr<VMObjectCombinator> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectCombinator>(o);
     }
 
     static symbol_t symbol(const VMObjectPtr &o) {
@@ -1679,7 +2405,7 @@ public:
     }
 
     static VMObjectPtr create(VM *vm, const symbol_t s) {
-        return std::make_shared<VMObjectData>(vm, s);
+        return make_vm_ptr<VMObjectData>(vm, s);
     }
 
     static VMObjectPtr create(VM *vm, const icu::UnicodeString &s) {
@@ -1705,12 +2431,12 @@ public:
     }
     */
 
-    static std::shared_ptr<VMObjectData> cast(const VMObjectPtr &o) {
-        return std::static_pointer_cast<VMObjectData>(o);
+    static vm_ptr<VMObjectData> cast(const VMObjectPtr &o) {
+        return vm_ptr_cast<VMObjectData>(o);
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
@@ -1719,11 +2445,7 @@ public:
 
         VMObjectPtr ret;
         if (tt.size() > 5) {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            ret = VMObjectArray::create(rr);
+            ret = VMObjectArray::erase(thunk, 0, 4);
         } else {
             ret = tt[4];
         }
@@ -1736,8 +2458,19 @@ public:
     }
 };
 
+// every object equals itself, also an opaque object whose compare never
+// returns 0, so the ordered and hashed containers see a consistent order
 struct CompareVMObjectPtr {
     int operator()(const VMObjectPtr &a0, const VMObjectPtr &a1) const {
+        // small integers and characters are ordered by address
+        if (a0 == a1) {
+            return 0;
+        } else if ((VMObjectInteger::is_small(a0.get()) &&
+                    VMObjectInteger::is_small(a1.get())) ||
+                   (VMObjectChar::is_small(a0.get()) &&
+                    VMObjectChar::is_small(a1.get()))) {
+            return (a0 < a1) ? -1 : 1;
+        }
         auto t0 = a0->tag();
         auto t1 = a1->tag();
         if (t0 < t1) {
@@ -1759,26 +2492,13 @@ struct CompareVMObjectPtr {
                 case VM_OBJECT_FLOAT: {
                     auto v0 = VMObjectFloat::value(a0);
                     auto v1 = VMObjectFloat::value(a1);
-                    if (v0 < v1)
-                        return -1;
-                    else if (v1 < v0)
-                        return 1;
-                    else
-                        return 0;
+                    return compare_float(v0, v1);
                 } break;
                 case VM_OBJECT_COMPLEX: {
                     auto z0 = VMObjectComplex::value(a0);
                     auto z1 = VMObjectComplex::value(a1);
-                    if (z0.real() < z1.real())
-                        return -1;
-                    else if (z1.real() < z0.real())
-                        return 1;
-                    else if (z0.imag() < z1.imag())
-                        return -1;
-                    else if (z1.imag() < z0.imag())
-                        return 1;
-                    else
-                        return 0;
+                    auto c = compare_float(z0.real(), z1.real());
+                    return (c != 0) ? c : compare_float(z0.imag(), z1.imag());
                 } break;
                 case VM_OBJECT_CHAR: {
                     auto v0 = VMObjectChar::value(a0);
@@ -1791,8 +2511,10 @@ struct CompareVMObjectPtr {
                         return 0;
                 } break;
                 case VM_OBJECT_TEXT: {
-                    auto v0 = VMObjectText::value(a0);
-                    auto v1 = VMObjectText::value(a1);
+                    auto t0 = static_cast<VMObjectText *>(a0.get());
+                    auto t1 = static_cast<VMObjectText *>(a1.get());
+                    auto &v0 = t0->value_ref();
+                    auto &v1 = t1->value_ref();
                     if (v0 < v1)
                         return -1;
                     else if (v1 < v0)
@@ -1821,8 +2543,8 @@ struct CompareVMObjectPtr {
                         return 0;
                 } break;
                 case VM_OBJECT_ARRAY: {
-                    auto v0 = VMObjectArray::value(a0);
-                    auto v1 = VMObjectArray::value(a1);
+                    auto &v0 = VMObjectArray::slots(a0);
+                    auto &v1 = VMObjectArray::slots(a1);
                     auto s0 = v0.size();
                     auto s1 = v1.size();
 
@@ -1844,6 +2566,18 @@ struct CompareVMObjectPtr {
         PANIC("switch failed");
         return 0;
     }
+
+    // a total order on floats, NaNs equal each other and come after every
+    // other float
+    static int compare_float(vm_float_t f0, vm_float_t f1) {
+        if (f0 < f1) {
+            return -1;
+        } else if (f1 < f0) {
+            return 1;
+        } else {
+            return (int)std::isnan(f0) - (int)std::isnan(f1);
+        }
+    }
 };
 struct EqualVMObjectPtr {
     bool operator()(const VMObjectPtr &a0, const VMObjectPtr &a1) const {
@@ -1857,6 +2591,60 @@ struct LessVMObjectPtr {
         return (compare(a0, a1) == -1);
     }
 };
+// consistent with the comparison above: objects which compare equal hash
+// the same, opaque objects hash by their symbol only
+struct HashVMObjectPtr {
+    size_t operator()(const VMObjectPtr &a) const {
+        switch (a->tag()) {
+            case VM_OBJECT_INTEGER:
+                return std::hash<vm_int_t>()(VMObjectInteger::value(a));
+            case VM_OBJECT_FLOAT:
+                return hash_float(VMObjectFloat::value(a));
+            case VM_OBJECT_COMPLEX: {
+                auto z = VMObjectComplex::value(a);
+                return combine(hash_float(z.real()), hash_float(z.imag()));
+            }
+            case VM_OBJECT_CHAR:
+                return std::hash<vm_char_t>()(VMObjectChar::value(a));
+            case VM_OBJECT_TEXT:
+                return static_cast<VMObjectText *>(a.get())->hash();
+            case VM_OBJECT_OPAQUE:
+            case VM_OBJECT_COMBINATOR:
+                return std::hash<symbol_t>()(a->symbol());
+            case VM_OBJECT_ARRAY:
+                return static_cast<VMObjectArray *>(a.get())->hash();
+        }
+        PANIC("switch failed");
+        return 0;
+    }
+
+    // -0.0 equals 0.0, and all NaNs are equal
+    static size_t hash_float(vm_float_t f) {
+        if (std::isnan(f)) return 1;
+        return (f == 0.0) ? 0 : std::hash<vm_float_t>()(f);
+    }
+
+    static size_t combine(size_t h0, size_t h1) {
+        return h0 ^ (h1 + 0x9e3779b97f4a7c15ULL + (h0 << 6) + (h0 >> 2));
+    }
+};
+
+// cached like the hash of texts, arrays which are shared aren't modified
+inline size_t VMObjectArray::hash() const {
+    std::atomic_ref<uint32_t> c(_hash);
+    auto v = c.load(std::memory_order_relaxed);
+    if (v == 0) {
+        HashVMObjectPtr hash;
+        size_t h = _size;
+        for (int i = 0; i < _size; i++) {
+            h = HashVMObjectPtr::combine(h, hash(_array()[i]));
+        }
+        v = static_cast<uint32_t>(h) | 1;
+        c.store(v, std::memory_order_relaxed);
+    }
+    return v;
+}
+
 using VMObjectPtrSet = std::set<VMObjectPtr, LessVMObjectPtr>;
 
 // a stub is used for finding objects by their string or symbol
@@ -1876,11 +2664,11 @@ public:
     }
 
     static VMObjectPtr create(VM *m, const symbol_t s) {
-        return std::make_shared<VMObjectStub>(m, s);
+        return make_vm_ptr<VMObjectStub>(m, s);
     }
 
     static VMObjectPtr create(VM *m, const UnicodeString &s) {
-        return std::make_shared<VMObjectStub>(m, s);
+        return make_vm_ptr<VMObjectStub>(m, s);
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
@@ -1903,14 +2691,14 @@ public:
     }
 
     static VMObjectPtr create(VM *m) {
-        return std::make_shared<VMThrow>(m);
+        return make_vm_ptr<VMThrow>(m);
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
         // when throw is reduced, it takes the exception, inserts it argument,
         // and reduces that
 
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
@@ -1935,11 +2723,7 @@ public:
 
             return r;
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            auto r = VMObjectArray::create(rr);
+            auto r = VMObjectArray::erase(thunk, 0, 4);
             auto index = VMObjectInteger::value(rti);
             auto rta = VMObjectArray::cast(rt);
             rta->set(index, r);
@@ -1958,11 +2742,11 @@ public:
     }
 
     static VMObjectPtr create(VM *m) {
-        return std::make_shared<VMHandle>(m);
+        return make_vm_ptr<VMHandle>(m);
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
@@ -1983,27 +2767,15 @@ public:
             hh.push_back(none);
             auto exc0 = VMObjectArray::create(hh);
 
-            VMObjectPtrs ff;
-            ff.push_back(rt);
-            ff.push_back(rti);
-            ff.push_back(k);
-            ff.push_back(exc0);
-            ff.push_back(f);
-            ff.push_back(none);
-
-            for (unsigned int i = 7; i < tt.size(); i++) {
-                ff.push_back(tt[i]);
-            }
-
-            auto r = VMObjectArray::create(ff);
+            auto r = VMObjectArray::erase(thunk, 4, 1);
+            auto ff = VMObjectArray::cast(r);
+            ff->set(3, exc0);
+            ff->set(4, f);
+            ff->set(5, none);
 
             return r;
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            auto r = VMObjectArray::create(rr);
+            auto r = VMObjectArray::erase(thunk, 0, 4);
             auto index = VMObjectInteger::value(rti);
             auto rta = VMObjectArray::cast(rt);
             rta->set(index, r);
@@ -2022,24 +2794,20 @@ public:
     }
 
     static VMObjectPtr create(VM *m) {
-        return std::make_shared<VMStall>(m);
+        return make_vm_ptr<VMStall>(m);
     }
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
-        auto exc = tt[3];
-        VMObjectPtrs rr;
+        VMObjectPtr r;
         if (tt.size() > 5) {
-            for (unsigned int i = 5; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
+            r = VMObjectArray::erase(thunk, 0, 5);
         } else {
-            rr.push_back(tt[4]);  // note: stall returns stall
+            r = tt[4];  // note: stall returns stall
         }
-        auto r = VMObjectArray::create(rr);
 
         auto index = VMObjectInteger::value(rti);
         auto rta = VMObjectArray::cast(rt);
@@ -2059,47 +2827,36 @@ public:
     }
 
     static VMObjectPtr create(VM *m) {
-        return std::make_shared<VMNapp>(m);
+        return make_vm_ptr<VMNapp>(m);
     }
 
     // napp f g x0..xn = f (g x0..xn)
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
         if (tt.size() > 6) {
             // set up f thunk
-            VMObjectPtrs ff;
-            ff.push_back(tt[0]);    // rt
-            ff.push_back(tt[1]);    // rti
-            ff.push_back(tt[2]);    // k
-            ff.push_back(tt[3]);    // exc
-            ff.push_back(tt[5]);    // f
-            ff.push_back(nullptr);  // .
-            auto f_thunk = VMObjectArray::create(ff);
-
-            // set up g thunk
-            VMObjectPtrs gg;
-            gg.push_back(f_thunk);                       // rt
-            gg.push_back(machine()->create_integer(5));  // rti
-            gg.push_back(f_thunk);                       // k
-            gg.push_back(tt[3]);                         // exc
-            gg.push_back(tt[6]);                         // g
-            for (unsigned int i = 7; i < tt.size(); i++) {
-                gg.push_back(tt[i]);
-            }
-            auto g_thunk = VMObjectArray::create(gg);
+            auto ff = VMObjectArray::cast(VMObjectArray::create(6));
+            ff->set(0, tt[0]);  // rt
+            ff->set(1, tt[1]);  // rti
+            ff->set(2, tt[2]);  // k
+            ff->set(3, tt[3]);  // exc
+            ff->set(4, tt[5]);  // f
+            VMObjectPtr f_thunk = ff;
+
+            // set up g thunk, it takes the place of the napp thunk
+            auto g_thunk = VMObjectArray::erase(thunk, 4, 2);
+            auto gg = VMObjectArray::cast(g_thunk);
+            gg->set(0, f_thunk);                       // rt
+            gg->set(1, machine()->create_integer(5));  // rti
+            gg->set(2, f_thunk);                       // k
 
             return g_thunk;
         } else {
             auto rt = tt[0];
             auto rti = tt[1];
             auto k = tt[2];
-            auto exc = tt[3];
 
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            auto r = VMObjectArray::create(rr);
+            auto r = VMObjectArray::erase(thunk, 0, 4);
 
             auto index = VMObjectInteger::value(rti);
             auto rta = VMObjectArray::cast(rt);
@@ -2129,20 +2886,20 @@ public:
     }
 };
 
-#define OPAQUE_PREAMBLE(t, c, n0, n1)                      \
-    c(VM *m) : Opaque(t, m, n0, n1) {                      \
-    }                                                      \
-    c(VM *m, const symbol_t s) : Opaque(t, m, s) {         \
-    }                                                      \
-    static VMObjectPtr create(VM *m) {                     \
-        return std::shared_ptr<c>(new c(m));               \
-    }                                                      \
-    static bool is_type(const VMObjectPtr &o) {            \
-        auto &r = *o.get();                                \
-        return typeid(r) == typeid(c);                     \
-    }                                                      \
-    static std::shared_ptr<c> cast(const VMObjectPtr &o) { \
-        return std::static_pointer_cast<c>(o);             \
+#define OPAQUE_PREAMBLE(t, c, n0, n1)              \
+    c(VM *m) : Opaque(t, m, n0, n1) {              \
+    }                                              \
+    c(VM *m, const symbol_t s) : Opaque(t, m, s) { \
+    }                                              \
+    static VMObjectPtr create(VM *m) {             \
+        return vm_ptr<c>(new c(m));                \
+    }                                              \
+    static bool is_type(const VMObjectPtr &o) {    \
+        auto &r = *o.get();                        \
+        return typeid(r) == typeid(c);             \
+    }                                              \
+    static vm_ptr<c> cast(const VMObjectPtr &o) {  \
+        return vm_ptr_cast<c>(o);                  \
     }
 
 // convenience classes for combinators which take and return constants
@@ -2161,21 +2918,18 @@ public:
     virtual VMObjectPtr apply() const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
 
         VMObjectPtr r;
-        if (tt.size() > 4) {
+        if (sz > 4) {
             try {
                 r = apply();
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
                 }
             } catch (VMObjectPtr e) {
                 auto exc = tt[3];
@@ -2192,21 +2946,14 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
         }
 
         // also return spurious arguments
-        if (tt.size() > 5) {
-            VMObjectPtrs rr;
-            rr.push_back(r);
-            for (unsigned int i = 5; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+        if (sz > 5) {
+            auto rr = VMObjectArray::erase(thunk, 0, 4);
+            VMObjectArray::cast(rr)->set(0, r);
+            r = rr;
         }
 
         auto index = VMObjectInteger::value(rti);
@@ -2225,7 +2972,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {    \
     }                                               \
     static VMObjectPtr create(VM *m) {              \
-        return std::shared_ptr<c>(new c(m));        \
+        return vm_ptr<c>(new c(m));                 \
     }
 
 class MedadicCallback : Medadic {
@@ -2295,23 +3042,20 @@ public:
     virtual VMObjectPtr apply(const VMObjectPtr &arg0) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
 
         VMObjectPtr r;
-        if (tt.size() > 5) {
+        if (sz > 5) {
             auto arg0 = tt[5];
 
             try {
                 r = apply(arg0);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
                 }
             } catch (VMObjectPtr e) {
                 auto exc = tt[3];
@@ -2330,21 +3074,14 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
         }
 
         // also return spurious arguments
-        if (tt.size() > 6) {
-            VMObjectPtrs rr;
-            rr.push_back(r);
-            for (unsigned int i = 6; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+        if (sz > 6) {
+            auto rr = VMObjectArray::erase(thunk, 0, 5);
+            VMObjectArray::cast(rr)->set(0, r);
+            r = rr;
         }
 
         auto index = VMObjectInteger::value(rti);
@@ -2363,7 +3100,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {    \
     }                                               \
     static VMObjectPtr create(VM *m) {              \
-        return std::shared_ptr<c>(new c(m));        \
+        return vm_ptr<c>(new c(m));                 \
     }
 
 class MonadicCallback : public Monadic {
@@ -2389,9 +3126,9 @@ public:
     static VMObjectPtr create(
         VM *m, const symbol_t sym,
         std::function<VMObjectPtr(const VMObjectPtr &a0)> f) {
-        // return std::shared_ptr<MonadicCallback>(new MonadicCallback(m, sym,
+        // return vm_ptr<MonadicCallback>(new MonadicCallback(m, sym,
         // f));
-        return std::shared_ptr<MonadicCallback>(new MonadicCallback(m, sym, f));
+        return vm_ptr<MonadicCallback>(new MonadicCallback(m, sym, f));
     }
 
     static VMObjectPtr create(
@@ -2442,30 +3179,26 @@ public:
                               const VMObjectPtr &arg1) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto m = machine();
-        auto rt = m->array_get(thunk, 0);
-        auto rti = m->array_get(thunk, 1);
-        auto k = m->array_get(thunk, 2);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
+        auto rt = tt[0];
+        auto rti = tt[1];
+        auto k = tt[2];
 
         VMObjectPtr r;
-        if (m->array_size(thunk) > 6) {
-            auto arg0 = m->array_get(thunk, 5);
-            auto arg1 = m->array_get(thunk, 6);
+        if (sz > 6) {
+            auto arg0 = tt[5];
+            auto arg1 = tt[6];
 
             try {
                 r = apply(arg0, arg1);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4;
-                         i < (unsigned int)m->array_size(thunk); i++) {
-                        rr.push_back(m->array_get(thunk, i));
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
                 }
             } catch (VMObjectPtr e) {
-                auto exc = m->array_get(thunk, 3);
+                auto exc = tt[3];
                 auto ee = VMObjectArray::value(exc);
-                auto none = m->create_none();
+                auto none = machine()->create_none();
 
                 VMObjectPtrs rr;
                 rr.push_back(ee[0]);
@@ -2479,23 +3212,14 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < (unsigned int)m->array_size(thunk);
-                 i++) {
-                rr.push_back(m->array_get(thunk, i));
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
         }
 
         // also return spurious arguments
-        if (m->array_size(thunk) > 7) {
-            VMObjectPtrs rr;
-            rr.push_back(r);
-            for (unsigned int i = 7; i < (unsigned int)m->array_size(thunk);
-                 i++) {
-                rr.push_back(m->array_get(thunk, i));
-            }
-            r = VMObjectArray::create(rr);
+        if (sz > 7) {
+            auto rr = VMObjectArray::erase(thunk, 0, 6);
+            VMObjectArray::cast(rr)->set(0, r);
+            r = rr;
         }
 
         auto index = VMObjectInteger::value(rti);
@@ -2514,7 +3238,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {   \
     }                                              \
     static VMObjectPtr create(VM *m) {             \
-        return std::shared_ptr<c>(new c(m));       \
+        return vm_ptr<c>(new c(m));                \
     }
 
 class DyadicCallback : public Dyadic {
@@ -2603,13 +3327,14 @@ public:
                               const VMObjectPtr &arg2) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
 
         VMObjectPtr r;
-        if (tt.size() > 7) {
+        if (sz > 7) {
             auto arg0 = tt[5];
             auto arg1 = tt[6];
             auto arg2 = tt[7];
@@ -2617,11 +3342,7 @@ public:
             try {
                 r = apply(arg0, arg1, arg2);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
                 }
             } catch (VMObjectPtr e) {
                 auto exc = tt[3];
@@ -2640,21 +3361,14 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
         }
 
         // also return spurious arguments
-        if (tt.size() > 8) {
-            VMObjectPtrs rr;
-            rr.push_back(r);
-            for (unsigned int i = 8; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+        if (sz > 8) {
+            auto rr = VMObjectArray::erase(thunk, 0, 7);
+            VMObjectArray::cast(rr)->set(0, r);
+            r = rr;
         }
 
         auto index = VMObjectInteger::value(rti);
@@ -2673,7 +3387,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {    \
     }                                               \
     static VMObjectPtr create(VM *m) {              \
-        return std::shared_ptr<c>(new c(m));        \
+        return vm_ptr<c>(new c(m));                 \
     }
 
 class TriadicCallback : public Triadic {
@@ -2764,26 +3478,23 @@ public:
     virtual VMObjectPtr apply(const VMObjectPtrs &args) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
 
         VMObjectPtr r;
-        if (tt.size() > 4) {
+        if (sz > 4) {
             VMObjectPtrs args;
-            for (unsigned int i = 5; i < tt.size(); i++) {
+            for (unsigned int i = 5; i < sz; i++) {
                 args.push_back(tt[i]);
             }
 
             try {
                 r = apply(args);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
                 }
             } catch (VMObjectPtr e) {
                 auto exc = tt[3];
@@ -2802,11 +3513,7 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
         }
 
         auto index = VMObjectInteger::value(rti);
@@ -2825,7 +3532,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {     \
     }                                                \
     static VMObjectPtr create(VM *m) {               \
-        return std::shared_ptr<c>(new c(m));         \
+        return vm_ptr<c>(new c(m));                  \
     }
 
 /*
@@ -2897,24 +3604,20 @@ public:
     virtual VMObjectPtr apply(const VMObjectPtr &arg0) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
-        auto exc = tt[3];
 
         VMObjectPtr r;
-        if (tt.size() > 5) {
+        if (sz > 5) {
             auto arg0 = tt[5];
 
             try {
                 r = apply(arg0);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
 
                     auto index = VMObjectInteger::value(rti);
                     auto rta = VMObjectArray::cast(rt);
@@ -2940,11 +3643,7 @@ public:
             }
         } else {
             // This seems the way to go about it.. Check Binary etc. for this.
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
             auto index = VMObjectInteger::value(rti);
             auto rta = VMObjectArray::cast(rt);
             rta->set(index, r);
@@ -2952,17 +3651,11 @@ public:
             return k;
         }
 
-        VMObjectPtrs kk;
-        kk.push_back(rt);
-        kk.push_back(rti);
-        kk.push_back(k);
-        kk.push_back(exc);
-        kk.push_back(r);
-        for (unsigned int n = 6; n < tt.size(); n++) {
-            kk.push_back(tt[n]);
-        }
+        // the thunk becomes a tail call to the result
+        auto kk = VMObjectArray::erase(thunk, 5, 1);
+        VMObjectArray::cast(kk)->set(4, r);
 
-        return VMObjectArray::create(kk);
+        return kk;
     }
 };
 
@@ -2974,7 +3667,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {  \
     }                                             \
     static VMObjectPtr create(VM *m) {            \
-        return std::shared_ptr<c>(new c(m));      \
+        return vm_ptr<c>(new c(m));               \
     }
 
 class Binary : public VMObjectCombinator {
@@ -2992,25 +3685,21 @@ public:
                               const VMObjectPtr &arg1) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
-        auto exc = tt[3];
 
         VMObjectPtr r;
-        if (tt.size() > 6) {
+        if (sz > 6) {
             auto arg0 = tt[5];
             auto arg1 = tt[6];
 
             try {
                 r = apply(arg0, arg1);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
 
                     auto index = VMObjectInteger::value(rti);
                     auto rta = VMObjectArray::cast(rt);
@@ -3035,11 +3724,7 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::erase(thunk, 0, 4);
             auto index = VMObjectInteger::value(rti);
             auto rta = VMObjectArray::cast(rt);
             rta->set(index, r);
@@ -3047,17 +3732,11 @@ public:
             return k;
         }
 
-        VMObjectPtrs kk;
-        kk.push_back(rt);
-        kk.push_back(rti);
-        kk.push_back(k);
-        kk.push_back(exc);
-        kk.push_back(r);
-        for (unsigned int n = 7; n < tt.size(); n++) {
-            kk.push_back(tt[n]);
-        }
+        // the thunk becomes a tail call to the result
+        auto kk = VMObjectArray::erase(thunk, 5, 2);
+        VMObjectArray::cast(kk)->set(4, r);
 
-        return VMObjectArray::create(kk);
+        return kk;
     }
 };
 
@@ -3069,7 +3748,7 @@ public:
     c(const c &o) : c(o.machine(), o.symbol()) {   \
     }                                              \
     static VMObjectPtr create(VM *m) {             \
-        return std::shared_ptr<c>(new c(m));       \
+        return vm_ptr<c>(new c(m));                \
     }
 
 class Ternary : public VMObjectCombinator {
@@ -3087,14 +3766,14 @@ public:
                               const VMObjectPtr &arg2) const = 0;
 
     VMObjectPtr reduce(const VMObjectPtr &thunk) const override {
-        auto tt = VMObjectArray::value(thunk);
+        auto &tt = VMObjectArray::slots(thunk);
+        auto sz = tt.size();
         auto rt = tt[0];
         auto rti = tt[1];
         auto k = tt[2];
-        auto exc = tt[3];
 
         VMObjectPtr r;
-        if (tt.size() > 7) {
+        if (sz > 7) {
             auto arg0 = tt[5];
             auto arg1 = tt[6];
             auto arg2 = tt[7];
@@ -3102,11 +3781,7 @@ public:
             try {
                 r = apply(arg0, arg1, arg2);
                 if (r == nullptr) {
-                    VMObjectPtrs rr;
-                    for (unsigned int i = 4; i < tt.size(); i++) {
-                        rr.push_back(tt[i]);
-                    }
-                    r = VMObjectArray::create(rr);
+                    r = VMObjectArray::create(&tt[4], sz - 4);
 
                     auto index = VMObjectInteger::value(rti);
                     auto rta = VMObjectArray::cast(rt);
@@ -3131,24 +3806,14 @@ public:
                 return VMObjectArray::create(rr);
             }
         } else {
-            VMObjectPtrs rr;
-            for (unsigned int i = 4; i < tt.size(); i++) {
-                rr.push_back(tt[i]);
-            }
-            r = VMObjectArray::create(rr);
+            r = VMObjectArray::create(&tt[4], sz - 4);
         }
 
-        VMObjectPtrs kk;
-        kk.push_back(rt);
-        kk.push_back(rti);
-        kk.push_back(k);
-        kk.push_back(exc);
-        kk.push_back(r);
-        for (unsigned int n = 8; n < tt.size(); n++) {
-            kk.push_back(tt[n]);
-        }
+        // the thunk becomes a tail call to the result
+        auto kk = VMObjectArray::erase(thunk, 5, (sz > 7) ? 3 : sz - 5);
+        VMObjectArray::cast(kk)->set(4, r);
 
-        return VMObjectArray::create(kk);
+        return kk;
     }
 };
 
@@ -3282,7 +3947,7 @@ void VMObjectArray::render(std::ostream &os) const {
     c(const c &o) : c(o.machine(), o.symbol()) {    \
     }                                               \
     static VMObjectPtr create(VM *m) {              \
-        return std::shared_ptr<c>(new c(m));        \
+        return vm_ptr<c>(new c(m));                 \
     }
 
 class CModule {
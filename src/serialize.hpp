@@ -1,9 +1,13 @@
 #pragma once
 
+#include <bit>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <stack>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "modules.hpp"
@@ -816,6 +820,365 @@ inline VMObjectPtr deserialize_from_string(VM *m, const icu::UnicodeString &s) {
     return o;
 };
 
+// a compact binary format. after a magic come a symbol table, the utf-8
+// names of all combinators, and the nodes of the dag, children first and
+// the root last. integers, lengths, and references are varints, where a
+// reference is the distance back to an earlier node, texts are raw utf-8,
+// and floats are little endian ieee doubles. it is encoded and decoded
+// directly from and to runtime objects.
+//
+// bytecode combinators carry their docstring, code, and constants, where
+// constants are literals or combinators by name. a reader defines shipped
+// bytecode under its name unless that name is already defined there, then
+// the local definition is used. the code is the bytecode of this version,
+// a stream with code which isn't well formed or names combinators which
+// are neither known nor shipped is rejected. other combinators, builtins
+// and data, are written by name only.
+
+const char BINARY_MAGIC[] = {'E', 'G', 'B', '1'};
+
+enum binary_tag_t : uint8_t {
+    BINARY_INTEGER = 'i',
+    BINARY_FLOAT = 'f',
+    BINARY_COMPLEX = 'z',
+    BINARY_CHAR = 'c',
+    BINARY_TEXT = 't',
+    BINARY_COMBINATOR = 'o',
+    BINARY_BYTECODE = 'b',
+    BINARY_ARRAY = 'a',
+};
+
+class BinaryWriter {
+public:
+    BinaryWriter(VM *m) : _machine(m) {
+    }
+
+    std::string write(const VMObjectPtr &o) {
+        // post-order over the dag, a node is written once all its
+        // children are
+        std::vector<std::pair<const VMObject *, size_t>> work;
+        work.emplace_back(o.get(), 0);
+        while (!work.empty()) {
+            auto &[o0, i] = work.back();
+            if (o0->tag() == VM_OBJECT_ARRAY) {
+                auto &aa = *static_cast<const VMObjectArray *>(o0);
+                if (i < aa.size()) {
+                    auto o1 = aa[i++].get();
+                    if (!_ids.contains(o1)) work.emplace_back(o1, 0);
+                    continue;
+                }
+            }
+            if (!_ids.contains(o0)) write_node(o0);
+            work.pop_back();
+        }
+
+        std::string s(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        write_varint(s, _symbol_count);
+        s.append(_symbols);
+        write_varint(s, _ids.size());
+        s.append(_nodes);
+        return s;
+    }
+
+    static void write_varint(std::string &s, uint64_t n) {
+        while (n >= 0x80) {
+            s.push_back((char)(n | 0x80));
+            n >>= 7;
+        }
+        s.push_back((char)n);
+    }
+
+    static void write_double(std::string &s, double f) {
+        auto n = std::bit_cast<uint64_t>(f);
+        for (int i = 0; i < 8; i++) {
+            s.push_back((char)(n >> (8 * i)));
+        }
+    }
+
+private:
+    void write_node(const VMObject *o) {
+        auto id = _ids.size();
+        switch (o->tag()) {
+            case VM_OBJECT_COMBINATOR:
+                if (o->subtag_test(VM_SUB_BYTECODE)) {
+                    write_bytecode(static_cast<const VMObjectBytecode *>(o));
+                } else {
+                    _nodes.push_back(BINARY_COMBINATOR);
+                    write_varint(_nodes, symbol_id(o->symbol()));
+                }
+                break;
+            case VM_OBJECT_ARRAY: {
+                auto &aa = *static_cast<const VMObjectArray *>(o);
+                _nodes.push_back(BINARY_ARRAY);
+                write_varint(_nodes, aa.size());
+                for (size_t i = 0; i < aa.size(); i++) {
+                    write_varint(_nodes, id - _ids[aa[i].get()]);
+                }
+            } break;
+            case VM_OBJECT_OPAQUE:
+                throw _machine->create_text("cannot serialize opaque");
+                break;
+            default:
+                write_literal(o);
+        }
+        _ids[o] = id;
+    }
+
+    void write_literal(const VMObject *o) {
+        switch (o->tag()) {
+            case VM_OBJECT_INTEGER: {
+                auto n = static_cast<const VMObjectInteger *>(o)->value();
+                _nodes.push_back(BINARY_INTEGER);
+                // zigzag, small negative numbers stay small
+                write_varint(_nodes, ((uint64_t)n << 1) ^ (uint64_t)(n >> 63));
+            } break;
+            case VM_OBJECT_FLOAT: {
+                auto f = static_cast<const VMObjectFloat *>(o)->value();
+                _nodes.push_back(BINARY_FLOAT);
+                write_double(_nodes, f);
+            } break;
+            case VM_OBJECT_COMPLEX: {
+                auto z = static_cast<const VMObjectComplex *>(o)->value();
+                _nodes.push_back(BINARY_COMPLEX);
+                write_double(_nodes, z.real());
+                write_double(_nodes, z.imag());
+            } break;
+            case VM_OBJECT_CHAR: {
+                auto c = static_cast<const VMObjectChar *>(o)->value();
+                _nodes.push_back(BINARY_CHAR);
+                write_varint(_nodes, (uint32_t)c);
+            } break;
+            case VM_OBJECT_TEXT:
+                _nodes.push_back(BINARY_TEXT);
+                write_text(static_cast<const VMObjectText *>(o)->value_ref());
+                break;
+            default:
+                throw _machine->create_text("cannot serialize");
+        }
+    }
+
+    void write_text(const icu::UnicodeString &t) {
+        _buffer.clear();
+        t.toUTF8String(_buffer);
+        write_varint(_nodes, _buffer.size());
+        _nodes.append(_buffer);
+    }
+
+    // constants are written in place, combinators among them by name so
+    // recursive code doesn't ship itself
+    void write_bytecode(const VMObjectBytecode *b) {
+        _nodes.push_back(BINARY_BYTECODE);
+        write_varint(_nodes, symbol_id(b->symbol()));
+        write_text(b->docstring());
+        auto c = b->code();
+        write_varint(_nodes, c.size());
+        _nodes.append(reinterpret_cast<const char *>(c.data()), c.size());
+        auto dd = b->data();
+        write_varint(_nodes, dd.size());
+        for (auto d : dd) {
+            auto k = _machine->get_data(d);
+            if (k->tag() == VM_OBJECT_COMBINATOR) {
+                _nodes.push_back(BINARY_COMBINATOR);
+                write_varint(_nodes, symbol_id(k->symbol()));
+            } else {
+                write_literal(k.get());
+            }
+        }
+    }
+
+    size_t symbol_id(const symbol_t s) {
+        auto it = _symbol_ids.find(s);
+        if (it == _symbol_ids.end()) {
+            _buffer.clear();
+            _machine->get_combinator_string(s).toUTF8String(_buffer);
+            write_varint(_symbols, _buffer.size());
+            _symbols.append(_buffer);
+            it = _symbol_ids.emplace(s, _symbol_count++).first;
+        }
+        return it->second;
+    }
+
+private:
+    VM *_machine;
+    std::unordered_map<const VMObject *, size_t> _ids;
+    std::unordered_map<symbol_t, size_t> _symbol_ids;
+    size_t _symbol_count = 0;
+    std::string _symbols;
+    std::string _nodes;
+    std::string _buffer;
+};
+
+class BinaryReader {
+public:
+    BinaryReader(VM *m, const std::string &s)
+        : _machine(m), _p(s.data()), _end(s.data() + s.size()) {
+    }
+
+    VMObjectPtr read() {
+        if ((size_t)(_end - _p) < sizeof(BINARY_MAGIC) ||
+            memcmp(_p, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+            error();
+        }
+        _p += sizeof(BINARY_MAGIC);
+
+        auto n = read_count();
+        for (size_t i = 0; i < n; i++) {
+            auto s = read_text();
+            _names.push_back(s);
+            _symbols.push_back(_machine->get_combinator(s));
+        }
+
+        VMObjectPtrs nodes;
+        n = read_count();
+        nodes.reserve(n);
+        for (size_t id = 0; id < n; id++) {
+            if (_p == _end) error();
+            switch (auto t = (uint8_t)*_p++) {
+                case BINARY_COMBINATOR:
+                    nodes.push_back(_symbols[read_symbol()]);
+                    break;
+                case BINARY_BYTECODE:
+                    nodes.push_back(read_bytecode());
+                    break;
+                case BINARY_ARRAY: {
+                    auto sz = read_count();
+                    if (sz < 2) error();
+                    auto aa = VMObjectArray::create(sz);
+                    auto &slots = *static_cast<VMObjectArray *>(aa.get());
+                    for (size_t i = 0; i < sz; i++) {
+                        auto d = read_varint();
+                        if (d == 0 || d > id) error();
+                        slots[i] = nodes[id - d];
+                    }
+                    nodes.push_back(aa);
+                } break;
+                default:
+                    nodes.push_back(read_literal(t));
+            }
+        }
+        if (nodes.empty() || _p != _end) error();
+        // every combinator named is either known here or was shipped
+        for (auto &o : _symbols) {
+            if (o->subtag() == VM_SUB_STUB) error();
+        }
+        return nodes.back();
+    }
+
+private:
+    VMObjectPtr read_literal(const uint8_t t) {
+        switch (t) {
+            case BINARY_INTEGER: {
+                auto z = read_varint();
+                auto i = (vm_int_t)((z >> 1) ^ (~(z & 1) + 1));
+                return VMObjectInteger::create(i);
+            }
+            case BINARY_FLOAT:
+                return VMObjectFloat::create(read_double());
+            case BINARY_COMPLEX: {
+                auto re = read_double();
+                auto im = read_double();
+                return VMObjectComplex::create({re, im});
+            }
+            case BINARY_CHAR:
+                return VMObjectChar::create((vm_char_t)read_varint());
+            case BINARY_TEXT:
+                return VMObjectText::create(read_text());
+            default:
+                error();
+        }
+    }
+
+    icu::UnicodeString read_text() {
+        auto len = read_count();
+        auto t = icu::UnicodeString::fromUTF8(icu::StringPiece(_p, len));
+        _p += len;
+        return t;
+    }
+
+    size_t read_symbol() {
+        auto i = read_varint();
+        if (i >= _symbols.size()) error();
+        return i;
+    }
+
+    // the local definition if there is one, otherwise the shipped code is
+    // defined, and constants are entered into the data table as on loading
+    // from the cache
+    VMObjectPtr read_bytecode() {
+        auto i = read_symbol();
+        auto doc = read_text();
+        auto n = read_count();
+        Code c(reinterpret_cast<const uint8_t *>(_p),
+               reinterpret_cast<const uint8_t *>(_p + n));
+        _p += n;
+        n = read_count();
+        Data dd;
+        for (size_t j = 0; j < n; j++) {
+            if (_p == _end) error();
+            auto t = (uint8_t)*_p++;
+            auto k = (t == BINARY_COMBINATOR) ? _symbols[read_symbol()]
+                                              : read_literal(t);
+            dd.push_back(_machine->enter_data(k));
+        }
+        if (!well_formed(c, dd.size())) error();
+        if (_symbols[i]->subtag() != VM_SUB_STUB) return _symbols[i];
+
+        auto b = VMObjectBytecode::create(_machine, c, dd, _names[i]);
+        VMObjectBytecode::cast(b)->set_docstring(doc);
+        _machine->overwrite(b);
+        _symbols[i] = b;
+        return b;
+    }
+
+    [[noreturn]] void error() {
+        throw _machine->create_text("malformed binary serialization");
+    }
+
+    uint64_t read_varint() {
+        uint64_t n = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (_p == _end) error();
+            auto b = (uint8_t)*_p++;
+            n |= (uint64_t)(b & 0x7f) << shift;
+            if (b < 0x80) return n;
+        }
+        error();
+    }
+
+    // a length or count, which cannot exceed what is left of the input
+    size_t read_count() {
+        auto n = read_varint();
+        if (n > (uint64_t)(_end - _p)) error();
+        return n;
+    }
+
+    double read_double() {
+        if (_end - _p < 8) error();
+        uint64_t n = 0;
+        for (int i = 0; i < 8; i++) {
+            n |= (uint64_t)(uint8_t)*_p++ << (8 * i);
+        }
+        return std::bit_cast<double>(n);
+    }
+
+private:
+    VM *_machine;
+    const char *_p;
+    const char *_end;
+    UnicodeStrings _names;
+    VMObjectPtrs _symbols;
+};
+
+inline std::string serialize_to_binary(VM *m, const VMObjectPtr &o) {
+    BinaryWriter w(m);
+    return w.write(o);
+};
+
+inline VMObjectPtr deserialize_from_binary(VM *m, const std::string &s) {
+    BinaryReader r(m, s);
+    return r.read();
+};
+
 inline VMObjectPtrs dependencies(VM *m, const VMObjectPtr &o) {
     VMObjectsStack work0;
     work0.push(o);
@@ -1,14 +1,16 @@
+import sys
+
 
 def genmod(n):
     print("namespace Test%d (" % n)
     print("     data true, false")
     print("")
-    print("     namespace F:G (")
+    print("     namespace F::G (")
     print("         def and =")
     print("             [ true true -> true | _ _ -> false ]")
     print("     )")
     print("")
-    print("     namespace I:J (")
+    print("     namespace I::J (")
     print("         def or =")
     print("             [ false false -> true | _ _ -> true ]")
     print("     )")
@@ -18,5 +20,6 @@ def genmod(n):
     print("")
     print(")")
 
-for i in range(0, 2000):
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+for i in range(0, n):
     genmod(i)